@@ -0,0 +1,545 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+// NOTE: to compile with g++, run "g++ -std=c++11 -O2 -pthread flood_init_gen.cpp -o flood_init_gen"
+
+// Generates the initial states of the flood model (FloodCell agents and the environment) from a config file, replacing the
+// hard coded SIZE, domain and bed_data() of xmlGen.cpp in Flood_XML_inpGen. The topography is read from an ESRI ASCII grid
+// (.asc) or a raw float raster (.flt with an ESRI .hdr) and resampled to the resolution of the flood agents in parallel.
+// Each z0 is the mean of the topography at the four corners of the agent, as xmlGen does with bed_data(). See example.cfg.
+
+#define HELP_OPTION_SHORT "-h"
+#define HELP_OPTION_LONG "--help"
+
+// Height given to cells without data in the topography, the height of the walls in xmlGen
+#define DEFAULT_NODATA_Z0 10.0
+
+// A raster of the topography, rows from north to south as in the ESRI formats
+struct Raster
+{
+	int ncols = 0;
+	int nrows = 0;
+	double xllcorner = 0.0;
+	double yllcorner = 0.0;
+	double cellsize = 1.0;
+	double nodata_value = -9999.0;
+	bool has_nodata = false;
+	std::vector<float> z;
+};
+
+// The settings of the generator, read from the config file
+struct Config
+{
+	int width = 0;		// flood agents along x
+	int height = 0;		// flood agents along y
+	double xmin = 0.0, xmax = 0.0, ymin = 0.0, ymax = 0.0;
+	bool domain_defined = false;
+
+	std::string topography_path;
+	double flat_z0 = 0.0;
+	double nodata_z0 = DEFAULT_NODATA_Z0;
+	double z0_offset = 0.0;
+
+	bool has_water_level = false;
+	double water_level = 0.0;
+
+	// environment variables in the order given, written as they are
+	std::vector<std::pair<std::string, std::string> > environment;
+};
+
+
+/////////////////////////////////////////////////// Reading the config ///////////////////////////////////////////////////
+
+std::string directoryOf(const std::string& path)
+{
+	size_t separator = path.find_last_of("/\\");
+	return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+// Reads the config file, one keyword per line followed by its values. Lines starting with '#' are comments.
+void readConfig(const char* path, Config& config)
+{
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not open config file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	char line[4096];
+	int line_no = 0;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		line_no++;
+		char* comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		std::vector<std::string> tokens;
+		char* token = strtok(line, " \t\r\n");
+		while (token != NULL)
+		{
+			tokens.push_back(token);
+			token = strtok(NULL, " \t\r\n");
+		}
+		if (tokens.empty())
+			continue;
+
+		const std::string& key = tokens[0];
+		size_t values = tokens.size() - 1;
+
+		if (key == "size" && (values == 1 || values == 2))
+		{
+			config.width = atoi(tokens[1].c_str());
+			config.height = values == 2 ? atoi(tokens[2].c_str()) : config.width;
+		}
+		else if (key == "domain" && values == 4)
+		{
+			config.xmin = atof(tokens[1].c_str());
+			config.xmax = atof(tokens[2].c_str());
+			config.ymin = atof(tokens[3].c_str());
+			config.ymax = atof(tokens[4].c_str());
+			config.domain_defined = true;
+		}
+		else if (key == "topography" && values == 1)
+		{
+			// relative to the config file
+			config.topography_path = tokens[1];
+			if (tokens[1][0] != '/' && tokens[1].find(':') == std::string::npos)
+				config.topography_path = directoryOf(path) + tokens[1];
+		}
+		else if (key == "flat_z0" && values == 1)
+			config.flat_z0 = atof(tokens[1].c_str());
+		else if (key == "nodata_z0" && values == 1)
+			config.nodata_z0 = atof(tokens[1].c_str());
+		else if (key == "z0_offset" && values == 1)
+			config.z0_offset = atof(tokens[1].c_str());
+		else if (key == "water_level" && values == 1)
+		{
+			config.water_level = atof(tokens[1].c_str());
+			config.has_water_level = true;
+		}
+		else if (key == "env" && values == 2)
+			config.environment.push_back(std::make_pair(tokens[1], tokens[2]));
+		else
+		{
+			fprintf(stderr, "Error: %s line %d: unknown keyword or wrong number of values for '%s'\n", path, line_no, key.c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+	fclose(fp);
+
+	if (config.width <= 0 || config.height <= 0)
+	{
+		fprintf(stderr, "Error: the config must define the number of flood agents in each direction, e.g. 'size 128' or 'size 256 64' (width height)\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!config.domain_defined || config.xmax <= config.xmin || config.ymax <= config.ymin)
+	{
+		fprintf(stderr, "Error: the config must define a domain, e.g. 'domain 0 15 0 15' (xmin xmax ymin ymax)\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+/////////////////////////////////////////////////// Reading the topography ///////////////////////////////////////////////////
+
+std::string readTextFile(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not open topography file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	std::string contents;
+	char buffer[1 << 16];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		contents.append(buffer, read);
+	fclose(fp);
+	return contents;
+}
+
+// Reads the ESRI header keys (ncols, nrows, xllcorner/xllcenter, yllcorner/yllcenter, cellsize, nodata_value and byteorder)
+// from the start of the text, returns the position after the header
+size_t readRasterHeader(const char* path, const std::string& text, Raster& raster, bool* big_endian)
+{
+	size_t position = 0;
+	bool xcenter = false, ycenter = false;
+	while (position < text.size())
+	{
+		size_t start = text.find_first_not_of(" \t\r\n", position);
+		if (start == std::string::npos)
+			break;
+		// the header ends at the first value
+		if (isdigit((unsigned char)text[start]) || text[start] == '-' || text[start] == '+' || text[start] == '.')
+			return start;
+
+		size_t key_end = text.find_first_of(" \t", start);
+		size_t line_end = text.find('\n', start);
+		if (key_end == std::string::npos || key_end > line_end)
+		{
+			fprintf(stderr, "Error: %s: malformed header line\n", path);
+			exit(EXIT_FAILURE);
+		}
+		std::string key = text.substr(start, key_end - start);
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+		std::string value = text.substr(key_end, (line_end == std::string::npos ? text.size() : line_end) - key_end);
+		const char* v = value.c_str() + value.find_first_not_of(" \t");
+
+		if (key == "ncols")
+			raster.ncols = atoi(v);
+		else if (key == "nrows")
+			raster.nrows = atoi(v);
+		else if (key == "xllcorner" || key == "xllcenter")
+		{
+			raster.xllcorner = atof(v);
+			xcenter = key == "xllcenter";
+		}
+		else if (key == "yllcorner" || key == "yllcenter")
+		{
+			raster.yllcorner = atof(v);
+			ycenter = key == "yllcenter";
+		}
+		else if (key == "cellsize")
+			raster.cellsize = atof(v);
+		else if (key == "nodata_value")
+		{
+			raster.nodata_value = atof(v);
+			raster.has_nodata = true;
+		}
+		else if (key == "byteorder" && big_endian != NULL)
+			*big_endian = (v[0] == 'M' || v[0] == 'm');
+
+		position = line_end == std::string::npos ? text.size() : line_end + 1;
+	}
+
+	if (xcenter)
+		raster.xllcorner -= 0.5 * raster.cellsize;
+	if (ycenter)
+		raster.yllcorner -= 0.5 * raster.cellsize;
+	if (raster.ncols <= 0 || raster.nrows <= 0 || raster.cellsize <= 0.0)
+	{
+		fprintf(stderr, "Error: %s: the header must define ncols, nrows and cellsize\n", path);
+		exit(EXIT_FAILURE);
+	}
+	return position;
+}
+
+// Reads an ESRI ASCII grid
+void readAsciiGrid(const char* path, Raster& raster)
+{
+	std::string text = readTextFile(path);
+	size_t position = readRasterHeader(path, text, raster, NULL);
+
+	size_t count = (size_t)raster.ncols * raster.nrows;
+	raster.z.resize(count);
+	const char* p = text.c_str() + position;
+	for (size_t i = 0; i < count; i++)
+	{
+		char* end;
+		raster.z[i] = strtof(p, &end);
+		if (end == p)
+		{
+			fprintf(stderr, "Error: %s: expected %d x %d values but found %d\n", path, raster.ncols, raster.nrows, (int)i);
+			exit(EXIT_FAILURE);
+		}
+		p = end;
+	}
+}
+
+// Reads a raw 32 bit float raster with the ESRI header of the same name (.hdr)
+void readFloatGrid(const char* path, Raster& raster)
+{
+	std::string header_path(path);
+	size_t extension = header_path.find_last_of('.');
+	header_path = header_path.substr(0, extension) + ".hdr";
+
+	bool big_endian = false;
+	std::string header = readTextFile(header_path.c_str());
+	readRasterHeader(header_path.c_str(), header, raster, &big_endian);
+
+	size_t count = (size_t)raster.ncols * raster.nrows;
+	raster.z.resize(count);
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL || fread(&raster.z[0], sizeof(float), count, fp) != count)
+	{
+		fprintf(stderr, "Error: could not read %d x %d floats from %s\n", raster.ncols, raster.nrows, path);
+		exit(EXIT_FAILURE);
+	}
+	fclose(fp);
+
+	unsigned int one = 1;
+	bool host_big_endian = *(unsigned char*)&one == 0;
+	if (big_endian != host_big_endian)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned char* b = (unsigned char*)&raster.z[i];
+			std::swap(b[0], b[3]);
+			std::swap(b[1], b[2]);
+		}
+	}
+}
+
+bool endsWith(const std::string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	if (text.size() < length)
+		return false;
+	std::string end = text.substr(text.size() - length);
+	std::transform(end.begin(), end.end(), end.begin(), ::tolower);
+	return end == suffix;
+}
+
+
+/////////////////////////////////////////////////// Resampling ///////////////////////////////////////////////////
+
+// Samples the topography at (x, y) with bilinear interpolation between the cell centres of the raster. Cells without data
+// and points outside the raster take the nodata height.
+double sampleRaster(const Raster& raster, const Config& config, double x, double y)
+{
+	// position in the raster in cells, column from the west and row from the north
+	double c = (x - raster.xllcorner) / raster.cellsize - 0.5;
+	double r = (raster.yllcorner + raster.nrows * raster.cellsize - y) / raster.cellsize - 0.5;
+	if (c < -0.5 || r < -0.5 || c > raster.ncols - 0.5 || r > raster.nrows - 0.5)
+		return config.nodata_z0;
+
+	c = std::min(std::max(c, 0.0), (double)(raster.ncols - 1));
+	r = std::min(std::max(r, 0.0), (double)(raster.nrows - 1));
+	int c0 = (int)c, r0 = (int)r;
+	int c1 = std::min(c0 + 1, raster.ncols - 1), r1 = std::min(r0 + 1, raster.nrows - 1);
+	double fc = c - c0, fr = r - r0;
+
+	double z[4] = { raster.z[(size_t)r0 * raster.ncols + c0], raster.z[(size_t)r0 * raster.ncols + c1],
+		raster.z[(size_t)r1 * raster.ncols + c0], raster.z[(size_t)r1 * raster.ncols + c1] };
+	for (int i = 0; i < 4; i++)
+		if (raster.has_nodata && z[i] == raster.nodata_value)
+			return config.nodata_z0;
+
+	return (z[0] * (1 - fc) + z[1] * fc) * (1 - fr) + (z[2] * (1 - fc) + z[3] * fc) * fr;
+}
+
+// Resamples the topography to the flood agents (index i + j*width, i along x), each thread taking a block of columns
+void resampleTopography(const Raster* raster, const Config& config, unsigned int threads, std::vector<double>& z0)
+{
+	int width = config.width;
+	int height = config.height;
+	double dx = (config.xmax - config.xmin) / width;
+	double dy = (config.ymax - config.ymin) / height;
+	z0.resize((size_t)width * height);
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&, t]() {
+			// the topography at the corners of the agents of one column
+			std::vector<double> west(height + 1), east(height + 1);
+			int begin = (int)((long long)width * t / threads);
+			int end = (int)((long long)width * (t + 1) / threads);
+			for (int i = begin; i < end; i++)
+			{
+				for (int j = 0; j <= height; j++)
+				{
+					double y = config.ymin + j * dy;
+					west[j] = raster ? sampleRaster(*raster, config, config.xmin + i * dx, y) : config.flat_z0;
+					east[j] = raster ? sampleRaster(*raster, config, config.xmin + (i + 1) * dx, y) : config.flat_z0;
+				}
+				for (int j = 0; j < height; j++)
+					z0[(size_t)i + (size_t)j * width] = (west[j] + east[j] + west[j + 1] + east[j + 1]) / 4 + config.z0_offset;
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+
+/////////////////////////////////////////////////// Writing the initial states ///////////////////////////////////////////////////
+
+// Formats the agents of columns [begin, end) into text, in the order of xmlGen (x in the outer loop)
+void formatAgents(const Config& config, const std::vector<double>& z0, int begin, int end, std::string& text)
+{
+	char agent[512];
+	text.clear();
+	text.reserve((size_t)(end - begin) * config.height * 96);
+	for (int i = begin; i < end; i++)
+	{
+		for (int j = 0; j < config.height; j++)
+		{
+			double z = z0[(size_t)i + (size_t)j * config.width];
+			int length = snprintf(agent, sizeof(agent), " <xagent>\n\t<name>FloodCell</name>\n\t<inDomain>1</inDomain>\n\t<x>%d</x>\n\t<y>%d</y>\n\t<z0>%f</z0>\n", i, j, z);
+			text.append(agent, length);
+			if (config.has_water_level && config.water_level > z)
+			{
+				length = snprintf(agent, sizeof(agent), "\t<h>%f</h>\n", config.water_level - z);
+				text.append(agent, length);
+			}
+			text.append(" </xagent>\n");
+		}
+	}
+}
+
+// Writes the initial states, the agents are formatted in parallel in blocks of columns and written in order
+void writeInitialStates(const char* output_path, const Config& config, const std::vector<double>& z0, unsigned int threads)
+{
+	FILE* fp = fopen(output_path, "wb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not create output file %s\n", output_path);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(fp, "<states>\n<itno>0</itno>\n <environment>\n\n");
+	fprintf(fp, "  <xmin>%g</xmin>\n  <xmax>%g</xmax>\n  <ymin>%g</ymin>\n  <ymax>%g</ymax>\n\n", config.xmin, config.xmax, config.ymin, config.ymax);
+	for (size_t i = 0; i < config.environment.size(); i++)
+		fprintf(fp, "  <%s>%s</%s>\n", config.environment[i].first.c_str(), config.environment[i].second.c_str(), config.environment[i].first.c_str());
+	fprintf(fp, "\n </environment>\n\n");
+
+	// blocks of 64 columns keep the buffers small, threads format the next blocks while one is written
+	const int block_columns = 64;
+	int blocks = (config.width + block_columns - 1) / block_columns;
+	std::vector<std::string> texts(threads);
+	for (int first = 0; first < blocks; first += threads)
+	{
+		std::vector<std::thread> workers;
+		int count = std::min((int)threads, blocks - first);
+		for (int t = 0; t < count; t++)
+		{
+			int begin = (first + t) * block_columns;
+			int end = std::min(begin + block_columns, config.width);
+			workers.push_back(std::thread(formatAgents, std::cref(config), std::cref(z0), begin, end, std::ref(texts[t])));
+		}
+		for (int t = 0; t < count; t++)
+		{
+			workers[t].join();
+			fwrite(texts[t].data(), 1, texts[t].size(), fp);
+		}
+	}
+
+	fprintf(fp, "</states>");
+	if (fclose(fp) != 0)
+	{
+		fprintf(stderr, "Error: could not write output file %s\n", output_path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Writes the resampled topography as a raw float raster with an ESRI header, which can be used as the topography of another config
+void writeFloatGrid(const char* path, const Config& config, const std::vector<double>& z0)
+{
+	std::string header_path(path);
+	header_path = header_path.substr(0, header_path.find_last_of('.')) + ".hdr";
+	FILE* hdr = fopen(header_path.c_str(), "w");
+	FILE* fp = fopen(path, "wb");
+	if (hdr == NULL || fp == NULL)
+	{
+		fprintf(stderr, "Error: could not create raster file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	unsigned int one = 1;
+	bool host_big_endian = *(unsigned char*)&one == 0;
+	fprintf(hdr, "ncols %d\nnrows %d\nxllcorner %f\nyllcorner %f\ncellsize %f\nbyteorder %s\n", config.width, config.height,
+		config.xmin, config.ymin, (config.xmax - config.xmin) / config.width, host_big_endian ? "MSBFIRST" : "LSBFIRST");
+	fclose(hdr);
+	if ((config.xmax - config.xmin) / config.width != (config.ymax - config.ymin) / config.height)
+		printf("Warning: the flood agents are not square, %s uses the cell size in x\n", header_path.c_str());
+
+	// rows from the north
+	std::vector<float> row(config.width);
+	for (int j = config.height - 1; j >= 0; j--)
+	{
+		for (int i = 0; i < config.width; i++)
+			row[i] = (float)z0[(size_t)i + (size_t)j * config.width];
+		fwrite(&row[0], sizeof(float), config.width, fp);
+	}
+	fclose(fp);
+}
+
+
+/////////////////////////////////////////////////// Main ///////////////////////////////////////////////////
+
+void printUsage(const char* executable)
+{
+	printf("\nusage: %s [-h] [--help] config output_path [-r raster.flt] [-t threads]\n", executable);
+	printf("\n");
+	printf("required arguments:\n");
+	printf("  config               Path to the config file (size, domain, topography and environment, see example.cfg)\n");
+	printf("  output_path          Path to the initial states XML file to write (e.g. flood_init.xml)\n");
+	printf("\n");
+	printf("options arguments:\n");
+	printf("  -h, --help           Output this help message.\n");
+	printf("  -r raster.flt        Also write the resampled topography as a raw float raster (with raster.hdr)\n");
+	printf("  -t threads           Number of threads used for resampling and formatting. Default is the number of hardware threads\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* config_path = NULL;
+	const char* output_path = NULL;
+	const char* raster_path = NULL;
+	unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], HELP_OPTION_SHORT) == 0 || strcmp(argv[i], HELP_OPTION_LONG) == 0)
+		{
+			printUsage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			raster_path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threads = std::max(atoi(argv[++i]), 1);
+		else if (config_path == NULL)
+			config_path = argv[i];
+		else if (output_path == NULL)
+			output_path = argv[i];
+		else
+		{
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (config_path == NULL || output_path == NULL)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Config config;
+	readConfig(config_path, config);
+
+	Raster raster;
+	bool has_raster = !config.topography_path.empty();
+	if (has_raster)
+	{
+		if (endsWith(config.topography_path, ".flt") || endsWith(config.topography_path, ".bil") || endsWith(config.topography_path, ".raw"))
+			readFloatGrid(config.topography_path.c_str(), raster);
+		else
+			readAsciiGrid(config.topography_path.c_str(), raster);
+		printf("Read %d x %d topography from %s\n", raster.ncols, raster.nrows, config.topography_path.c_str());
+	}
+
+	std::vector<double> z0;
+	resampleTopography(has_raster ? &raster : NULL, config, std::min(threads, (unsigned int)config.width), z0);
+
+	writeInitialStates(output_path, config, z0, threads);
+	printf("%d x %d flood agents written to %s\n", config.width, config.height, output_path);
+
+	if (raster_path != NULL)
+	{
+		writeFloatGrid(raster_path, config, z0);
+		printf("Resampled topography written to %s\n", raster_path);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,655 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// NOTE: to compile with g++, run "g++ -std=c++11 -O3 -march=native -pthread flood_stencil_cpu.cpp -o flood_stencil_cpu"
+
+// CPU execution of the flood layers of the model (PrepareWetDry, ProcessWetDryMessage, PrepareSpaceOperator and
+// ProcessSpaceOperatorMessage of the FloodCell agents in functions.c, on a closed reflective box with a sloping bed and the
+// Manning friction of the cells). The same steps are run in two ways:
+//
+//   layers  one pass over the whole grid per layer, each layer reading the agent variables and messages of the last from memory,
+//           as the layers of the model are executed by FLAMEGPU
+//   tiled   the grid is cut into tiles sized for the L2 cache, each tile is copied with a halo of 2 cells per step into a buffer
+//           of the thread and the four layers of 'steps per tile' steps are executed on it before the tile is written back
+//
+// Every message of the layers has a radius of 1 cell, so a step of a cell depends on the cells within 2 cells of it. The halo of
+// the tiles is computed redundantly by the neighbouring tiles, which gives results identical to the layers. As the layers of a
+// tile are executed without a synchronisation of the domain, the time-step of the 'steps per tile' steps is the minimum CFL
+// time-step of the domain at the first of them (both ways use the same time-steps, the global time-step of the model is the
+// case of 1 step per tile). The CFL number of the model is divided by 'steps per tile' for the steps to remain stable.
+//
+// The tool reports the cell updates per second of both ways and the effective memory bandwidth taken as the bytes of the agent
+// variables a step has to read and write at least (h, qx, qy, z0, nm_rough read, h, qx, qy, timeStep written). The exit status
+// is EXIT_FAILURE if the tiled results differ from the layers.
+//
+// usage: flood_stencil_cpu [size] [steps] [steps_per_tile] [threads] [l2_kb]
+
+#define GRAVITY 9.80665
+#define CFL 0.5
+#define TOL_H 10.0e-4
+#define BIG_NUMBER 800000
+#define emsmall 1.0e-12
+
+#define DOMAIN_SIZE 1000.0		// the box is DOMAIN_SIZE x DOMAIN_SIZE metres
+#define BED_SLOPE 0.001			// the bed rises to the east
+#define MANNING 0.018
+#define DAM_RADIUS 200.0
+#define DAM_DEPTH 2.0
+
+// Bytes a step has to read and write at least per cell, see above
+#define BYTES_PER_CELL_STEP (9 * sizeof(double))
+
+// The agent variables and messages of the flood layers for a block of cells (the whole grid or the buffer of a tile)
+struct Fields
+{
+	int width = 0;
+	int height = 0;
+
+	// FloodCell agent variables
+	std::vector<double> h, qx, qy, z0, nm_rough, minh_loc, timeStep;
+
+	// WetDryMessage
+	std::vector<int> wd_inDomain;
+	std::vector<double> wd_min_hloc;
+
+	// SpaceOperatorMessage, the h, et, qx and qy of the E, W, N and S faces of each cell
+	std::vector<int> so_inDomain;
+	std::vector<double> so_face;
+
+	void resize(int w, int hgt)
+	{
+		width = w;
+		height = hgt;
+		size_t n = (size_t)w * hgt;
+		for (std::vector<double>* v : { &h, &qx, &qy, &z0, &nm_rough, &minh_loc, &timeStep, &wd_min_hloc })
+			v->resize(n);
+		wd_inDomain.resize(n);
+		so_inDomain.resize(n);
+		so_face.resize(n * 16);
+	}
+
+	static size_t bytesPerCell() { return 8 * sizeof(double) + 2 * sizeof(int) + 16 * sizeof(double); }
+};
+
+// A block of cells [x0, x1) x [y0, y1)
+struct Rect
+{
+	int x0, y0, x1, y1;
+};
+
+enum FaceDirection { FACE_E = 0, FACE_W = 1, FACE_N = 2, FACE_S = 3 };
+
+struct Flux
+{
+	double x, y, z;
+};
+
+
+/////////////////////////////////////////////////// Shallow water solver (as functions.c) ///////////////////////////////////////////////////
+
+void friction_2D(double dt_loc, double h_loc, double& qx_loc, double& qy_loc, double nm_rough)
+{
+	if (h_loc <= TOL_H)
+	{
+		qx_loc = 0.0;
+		qy_loc = 0.0;
+		return;
+	}
+
+	double u_loc = qx_loc / h_loc;
+	double v_loc = qy_loc / h_loc;
+
+	if ((fabs(u_loc) <= emsmall) && (fabs(v_loc) <= emsmall))
+		return;
+
+	double Cf = GRAVITY * pow(nm_rough, 2.0) / pow(h_loc, 1.0 / 3.0);
+
+	double expULoc = pow(u_loc, 2.0);
+	double expVLoc = pow(v_loc, 2.0);
+
+	double Sfx = -Cf * u_loc * sqrt(expULoc + expVLoc);
+	double Sfy = -Cf * v_loc * sqrt(expULoc + expVLoc);
+
+	double DDx = 1.0 + dt_loc * (Cf / h_loc * (2.0 * expULoc + expVLoc) / sqrt(expULoc + expVLoc));
+	double DDy = 1.0 + dt_loc * (Cf / h_loc * (expULoc + 2.0 * expVLoc) / sqrt(expULoc + expVLoc));
+
+	qx_loc = qx_loc + (dt_loc * (Sfx / DDx));
+	qy_loc = qy_loc + (dt_loc * (Sfy / DDy));
+}
+
+// Non-negative reconstruction of the Riemann states of a face as WD, for a face of the given side of the cell
+void WD(double h_L, double h_R, double et_L, double et_R, double qx_L, double qx_R, double qy_L, double qy_R, FaceDirection ndir,
+	double& z_LR, double& h_L_star, double& h_R_star, double& qx_L_star, double& qx_R_star, double& qy_L_star, double& qy_R_star)
+{
+	double z_L = et_L - h_L;
+	double z_R = et_R - h_R;
+
+	double u_L = 0.0, v_L = 0.0, u_R = 0.0, v_R = 0.0;
+
+	if (h_L > TOL_H)
+	{
+		u_L = qx_L / h_L;
+		v_L = qy_L / h_L;
+	}
+
+	if (h_R > TOL_H)
+	{
+		u_R = qx_R / h_R;
+		v_R = qy_R / h_R;
+	}
+
+	z_LR = std::max(z_L, z_R);
+
+	double delta = ((ndir == FACE_N) || (ndir == FACE_E)) ? std::max(0.0, -(et_L - z_LR)) : std::max(0.0, -(et_R - z_LR));
+
+	h_L_star = std::max(0.0, et_L - z_LR);
+	double et_L_star = h_L_star + z_LR;
+	qx_L_star = h_L_star * u_L;
+	qy_L_star = h_L_star * v_L;
+
+	h_R_star = std::max(0.0, et_R - z_LR);
+	double et_R_star = h_R_star + z_LR;
+	qx_R_star = h_R_star * u_R;
+	qy_R_star = h_R_star * v_R;
+
+	if (delta > 0.0)
+	{
+		z_LR = z_LR - delta;
+		et_L_star = et_L_star - delta;
+		et_R_star = et_R_star - delta;
+	}
+
+	h_L_star = et_L_star - z_LR;
+	h_R_star = et_R_star - z_LR;
+}
+
+Flux F_SWE(double hh, double qx, double qy)
+{
+	if (hh <= TOL_H)
+		return Flux{ 0.0, 0.0, 0.0 };
+
+	return Flux{ qx, (pow(qx, 2.0) / hh) + ((GRAVITY / 2.0) * pow(hh, 2.0)), (qx * qy) / hh };
+}
+
+// HLL flux in x direction as hll_x, the normal momentum is qx. hll_y is the same with qx and qy (and the flux components) swapped.
+Flux hll_x(double h_L, double h_R, double qx_L, double qx_R, double qy_L, double qy_R)
+{
+	Flux F_face = { 0.0, 0.0, 0.0 };
+
+	if ((h_L <= TOL_H) && (h_R <= TOL_H))
+		return F_face;
+
+	double u_L = 0.0, v_L = 0.0, u_R = 0.0, v_R = 0.0;
+
+	if (h_L <= TOL_H)
+		h_L = 0.0;
+	else
+	{
+		u_L = qx_L / h_L;
+		v_L = qy_L / h_L;
+	}
+
+	if (h_R <= TOL_H)
+		h_R = 0.0;
+	else
+	{
+		u_R = qx_R / h_R;
+		v_R = qy_R / h_R;
+	}
+
+	double a_L = sqrt(GRAVITY * h_L);
+	double a_R = sqrt(GRAVITY * h_R);
+
+	double h_star = pow(((a_L + a_R) / 2.0 + (u_L - u_R) / 4.0), 2) / GRAVITY;
+	double u_star = (u_L + u_R) / 2.0 + a_L - a_R;
+	double a_star = sqrt(GRAVITY * h_star);
+
+	double s_L = (h_L <= TOL_H) ? u_R - (2.0 * a_R) : std::min(u_L - a_L, u_star - a_star);
+	double s_R = (h_R <= TOL_H) ? u_L + (2.0 * a_L) : std::max(u_R + a_R, u_star + a_star);
+
+	double s_M = ((s_L * h_R * (u_R - s_R)) - (s_R * h_L * (u_L - s_L))) / (h_R * (u_R - s_R) - (h_L * (u_L - s_L)));
+
+	Flux F_L = F_SWE(h_L, qx_L, qy_L);
+	Flux F_R = F_SWE(h_R, qx_R, qy_R);
+
+	if (s_L >= 0.0)
+	{
+		F_face = F_L;
+	}
+	else if ((s_L < 0.0) && s_R >= 0.0)
+	{
+		double F1_M = ((s_R * F_L.x) - (s_L * F_R.x) + s_L * s_R * (h_R - h_L)) / (s_R - s_L);
+		double F2_M = ((s_R * F_L.y) - (s_L * F_R.y) + s_L * s_R * (qx_R - qx_L)) / (s_R - s_L);
+
+		if ((s_L < 0.0) && (s_M >= 0.0))
+			F_face = Flux{ F1_M, F2_M, F1_M * v_L };
+		else if ((s_M < 0.0) && (s_R >= 0.0))
+			F_face = Flux{ F1_M, F2_M, F1_M * v_R };
+	}
+	else if (s_R < 0)
+	{
+		F_face = F_R;
+	}
+
+	return F_face;
+}
+
+Flux hll_y(double h_S, double h_N, double qx_S, double qx_N, double qy_S, double qy_N)
+{
+	Flux G = hll_x(h_S, h_N, qy_S, qy_N, qx_S, qx_N);
+	return Flux{ G.x, G.z, G.y };
+}
+
+
+/////////////////////////////////////////////////// Flood layers ///////////////////////////////////////////////////
+
+// The layers of a cell (x, y) of a block of Fields. The neighbours outside of the block send no message, as at the walls of the
+// domain: the layers of the cells within 2 cells of the edge of a tile buffer are only correct where the edge is a wall.
+
+void PrepareWetDry(Fields& f, int x, int y)
+{
+	size_t i = (size_t)y * f.width + x;
+	f.minh_loc[i] = f.h[i];
+	f.wd_inDomain[i] = 1;
+	f.wd_min_hloc[i] = f.minh_loc[i];
+}
+
+void ProcessWetDryMessage(Fields& f, int x, int y, double dt)
+{
+	size_t i = (size_t)y * f.width + x;
+	double minh_loc = f.minh_loc[i];
+
+	for (int j = std::max(0, y - 1); j <= std::min(f.height - 1, y + 1); j++)
+		for (int k = std::max(0, x - 1); k <= std::min(f.width - 1, x + 1); k++)
+		{
+			size_t n = (size_t)j * f.width + k;
+			if (f.wd_inDomain[n])
+				minh_loc = std::min(minh_loc, f.wd_min_hloc[n]);
+		}
+
+	f.minh_loc[i] = minh_loc;
+
+	if (minh_loc > TOL_H)
+	{
+		// Friction_Implicit
+		if ((f.nm_rough[i] > 0.0) && (f.h[i] > TOL_H))
+			friction_2D(dt, f.h[i], f.qx[i], f.qy[i], f.nm_rough[i]);
+	}
+	else
+	{
+		f.minh_loc[i] = BIG_NUMBER;
+	}
+}
+
+void PrepareSpaceOperator(Fields& f, int x, int y)
+{
+	size_t i = (size_t)y * f.width + x;
+	double* face = &f.so_face[i * 16];
+
+	if (f.minh_loc[i] > TOL_H)
+	{
+		f.so_inDomain[i] = 1;
+		for (int d = 0; d < 4; d++)
+		{
+			face[d * 4 + 0] = f.h[i];
+			face[d * 4 + 1] = f.z0[i] + f.h[i];
+			face[d * 4 + 2] = f.qx[i];
+			face[d * 4 + 3] = f.qy[i];
+		}
+	}
+	else
+	{
+		f.so_inDomain[i] = 0;
+		for (int d = 0; d < 16; d++)
+			face[d] = 0.0;
+	}
+}
+
+// The SpaceOperatorMessage of the neighbour of a cell in a direction, the face values of the neighbour facing the cell
+const double* neighbourFace(const Fields& f, int x, int y, FaceDirection dir)
+{
+	int nx = x + ((dir == FACE_E) ? 1 : (dir == FACE_W) ? -1 : 0);
+	int ny = y + ((dir == FACE_N) ? 1 : (dir == FACE_S) ? -1 : 0);
+
+	if ((nx < 0) || (nx >= f.width) || (ny < 0) || (ny >= f.height))
+		return NULL;
+
+	size_t n = (size_t)ny * f.width + nx;
+	if (!f.so_inDomain[n])
+		return NULL;
+
+	static const int opposite[4] = { FACE_W, FACE_E, FACE_S, FACE_N };
+	return &f.so_face[n * 16 + opposite[dir] * 4];
+}
+
+void ProcessSpaceOperatorMessage(Fields& f, int x, int y, double dt, double dxl, double dyl)
+{
+	size_t i = (size_t)y * f.width + x;
+
+	// the local face values of the cell (LFV, identical on all faces)
+	double h = f.h[i];
+	double et = f.z0[i] + f.h[i];
+	double qx = f.qx[i];
+	double qy = f.qy[i];
+
+	double z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R;
+
+	// EAST face, a reflective wall unless the neighbour sent a message
+	const double* m = neighbourFace(f, x, y, FACE_E);
+	if (m)
+		WD(h, m[0], et, m[1], qx, m[2], qy, m[3], FACE_E, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	else
+		WD(h, h, et, et, qx, -qx, qy, qy, FACE_E, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	Flux FPlus = hll_x(h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	double zbF_E = z_F;
+	double hf_E = h_F_L;
+
+	// WEST face
+	m = neighbourFace(f, x, y, FACE_W);
+	if (m)
+		WD(m[0], h, m[1], et, m[2], qx, m[3], qy, FACE_W, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	else
+		WD(h, h, et, et, -qx, qx, qy, qy, FACE_W, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	Flux FMinus = hll_x(h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	double zbF_W = z_F;
+	double hf_W = h_F_R;
+
+	// NORTH face
+	m = neighbourFace(f, x, y, FACE_N);
+	if (m)
+		WD(h, m[0], et, m[1], qx, m[2], qy, m[3], FACE_N, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	else
+		WD(h, h, et, et, qx, qx, qy, -qy, FACE_N, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	Flux GPlus = hll_y(h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	double zbF_N = z_F;
+	double hf_N = h_F_L;
+
+	// SOUTH face
+	m = neighbourFace(f, x, y, FACE_S);
+	if (m)
+		WD(m[0], h, m[1], et, m[2], qx, m[3], qy, FACE_S, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	else
+		WD(h, h, et, et, qx, qx, -qy, qy, FACE_S, z_F, h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	Flux GMinus = hll_y(h_F_L, h_F_R, qx_F_L, qx_F_R, qy_F_L, qy_F_R);
+	double zbF_S = z_F;
+	double hf_S = h_F_R;
+
+	// bed slope source terms
+	double z1x_bar = (zbF_E - zbF_W) / 2.0;
+	double z1y_bar = (zbF_N - zbF_S) / 2.0;
+	double h0x_bar = (hf_E + hf_W) / 2.0;
+	double h0y_bar = (hf_N + hf_S) / 2.0;
+	double SS_2 = (-GRAVITY * h0x_bar * 2.0 * z1x_bar) / dxl;
+	double SS_3 = (-GRAVITY * h0y_bar * 2.0 * z1y_bar) / dyl;
+
+	// UpdateFloodCell
+	f.h[i] = h - (dt / dxl) * (FPlus.x - FMinus.x) - (dt / dyl) * (GPlus.x - GMinus.x);
+	f.qx[i] = qx - (dt / dxl) * (FPlus.y - FMinus.y) - (dt / dyl) * (GPlus.y - GMinus.y) + dt * SS_2;
+	f.qy[i] = qy - (dt / dxl) * (FPlus.z - FMinus.z) - (dt / dyl) * (GPlus.z - GMinus.z) + dt * SS_3;
+
+	double hp = f.h[i];
+	f.timeStep[i] = BIG_NUMBER;
+
+	if (hp <= TOL_H)
+	{
+		f.qx[i] = 0.0;
+		f.qy[i] = 0.0;
+	}
+	else
+	{
+		double up = f.qx[i] / hp;
+		double vp = f.qy[i] / hp;
+		f.timeStep[i] = fmin(CFL * dxl / (fabs(up) + sqrt(GRAVITY * hp)), CFL * dyl / (fabs(vp) + sqrt(GRAVITY * hp)));
+	}
+}
+
+
+/////////////////////////////////////////////////// Execution ///////////////////////////////////////////////////
+
+struct Settings
+{
+	int size;
+	int steps;
+	int steps_per_tile;
+	int threads;
+	int tile;
+	double dxl;
+	double dyl;
+};
+
+// Runs body(y) for the rows [0, rows) split over the threads
+template <typename Body>
+void parallelRows(int rows, int threads, const Body& body)
+{
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; t++)
+		pool.emplace_back([&, t]() {
+			for (int y = (int)((long long)rows * t / threads); y < (int)((long long)rows * (t + 1) / threads); y++)
+				body(y);
+		});
+	for (std::thread& thread : pool)
+		thread.join();
+}
+
+double minTimeStep(const std::vector<double>& timeStep)
+{
+	double dt = BIG_NUMBER;
+	for (double t : timeStep)
+		dt = std::min(dt, t);
+	return dt;
+}
+
+// One step of the layers over the whole grid, a pass (and synchronisation) per layer
+void layerStep(Fields& grid, double dt, const Settings& s)
+{
+	int w = grid.width;
+	parallelRows(grid.height, s.threads, [&](int y) { for (int x = 0; x < w; x++) PrepareWetDry(grid, x, y); });
+	parallelRows(grid.height, s.threads, [&](int y) { for (int x = 0; x < w; x++) ProcessWetDryMessage(grid, x, y, dt); });
+	parallelRows(grid.height, s.threads, [&](int y) { for (int x = 0; x < w; x++) PrepareSpaceOperator(grid, x, y); });
+	parallelRows(grid.height, s.threads, [&](int y) { for (int x = 0; x < w; x++) ProcessSpaceOperatorMessage(grid, x, y, dt, s.dxl, s.dyl); });
+}
+
+// The block of a buffer moved in by margin from the sides that are not walls of the domain
+Rect shrink(const Rect& block, const Rect& buffer, int size, int margin)
+{
+	Rect r = block;
+	if (buffer.x0 > 0) r.x0 += margin;
+	if (buffer.y0 > 0) r.y0 += margin;
+	if (buffer.x1 < size) r.x1 -= margin;
+	if (buffer.y1 < size) r.y1 -= margin;
+	return r;
+}
+
+template <typename Layer>
+void forCells(const Rect& r, const Layer& layer)
+{
+	for (int y = r.y0; y < r.y1; y++)
+		for (int x = r.x0; x < r.x1; x++)
+			layer(x, y);
+}
+
+// steps_per_tile steps of a tile, from the grid src to the grid dst, in the buffer of a thread
+void tileSteps(const Fields& src, Fields& dst, Fields& local, const Rect& tile, double dt, const Settings& s)
+{
+	int halo = 2 * s.steps_per_tile;
+	Rect buffer = { std::max(0, tile.x0 - halo), std::max(0, tile.y0 - halo), std::min(s.size, tile.x1 + halo), std::min(s.size, tile.y1 + halo) };
+
+	local.resize(buffer.x1 - buffer.x0, buffer.y1 - buffer.y0);
+	for (int y = buffer.y0; y < buffer.y1; y++)
+	{
+		size_t g = (size_t)y * s.size + buffer.x0;
+		size_t l = (size_t)(y - buffer.y0) * local.width;
+		size_t n = (size_t)local.width;
+		std::copy(&src.h[g], &src.h[g] + n, &local.h[l]);
+		std::copy(&src.qx[g], &src.qx[g] + n, &local.qx[l]);
+		std::copy(&src.qy[g], &src.qy[g] + n, &local.qy[l]);
+		std::copy(&src.z0[g], &src.z0[g] + n, &local.z0[l]);
+		std::copy(&src.nm_rough[g], &src.nm_rough[g] + n, &local.nm_rough[l]);
+	}
+
+	// the cells a layer is correct for shrink by a cell for each message read
+	Rect all = { 0, 0, local.width, local.height };
+	for (int step = 0; step < s.steps_per_tile; step++)
+	{
+		int margin = 2 * step;
+		forCells(shrink(all, buffer, s.size, margin), [&](int x, int y) { PrepareWetDry(local, x, y); });
+		forCells(shrink(all, buffer, s.size, margin + 1), [&](int x, int y) { ProcessWetDryMessage(local, x, y, dt); });
+		forCells(shrink(all, buffer, s.size, margin + 1), [&](int x, int y) { PrepareSpaceOperator(local, x, y); });
+		forCells(shrink(all, buffer, s.size, margin + 2), [&](int x, int y) { ProcessSpaceOperatorMessage(local, x, y, dt, s.dxl, s.dyl); });
+	}
+
+	for (int y = tile.y0; y < tile.y1; y++)
+	{
+		size_t g = (size_t)y * s.size + tile.x0;
+		size_t l = (size_t)(y - buffer.y0) * local.width + (tile.x0 - buffer.x0);
+		size_t n = (size_t)(tile.x1 - tile.x0);
+		std::copy(&local.h[l], &local.h[l] + n, &dst.h[g]);
+		std::copy(&local.qx[l], &local.qx[l] + n, &dst.qx[g]);
+		std::copy(&local.qy[l], &local.qy[l] + n, &dst.qy[g]);
+		std::copy(&local.timeStep[l], &local.timeStep[l] + n, &dst.timeStep[g]);
+	}
+}
+
+// steps_per_tile steps of all tiles, the threads take the tiles in turn
+void tiledSteps(Fields& src, Fields& dst, std::vector<Fields>& locals, double dt, const Settings& s)
+{
+	int tiles_x = (s.size + s.tile - 1) / s.tile;
+	int tiles = tiles_x * tiles_x;
+	std::atomic<int> next(0);
+
+	std::vector<std::thread> pool;
+	for (int t = 0; t < s.threads; t++)
+		pool.emplace_back([&, t]() {
+			for (int i = next++; i < tiles; i = next++)
+			{
+				int tx = (i % tiles_x) * s.tile;
+				int ty = (i / tiles_x) * s.tile;
+				Rect tile = { tx, ty, std::min(s.size, tx + s.tile), std::min(s.size, ty + s.tile) };
+				tileSteps(src, dst, locals[t], tile, dt, s);
+			}
+		});
+	for (std::thread& thread : pool)
+		thread.join();
+
+	std::swap(src.h, dst.h);
+	std::swap(src.qx, dst.qx);
+	std::swap(src.qy, dst.qy);
+	std::swap(src.timeStep, dst.timeStep);
+}
+
+// A dam-break on a bed sloping up to the east, with the CFL number of the model divided by the steps of a tile
+Fields damBreak(const Settings& s)
+{
+	Fields grid;
+	grid.resize(s.size, s.size);
+
+	for (int y = 0; y < s.size; y++)
+		for (int x = 0; x < s.size; x++)
+		{
+			size_t i = (size_t)y * s.size + x;
+			double cx = (x + 0.5) * s.dxl - 0.5 * DOMAIN_SIZE;
+			double cy = (y + 0.5) * s.dyl - 0.5 * DOMAIN_SIZE;
+			grid.z0[i] = BED_SLOPE * (x + 0.5) * s.dxl;
+			grid.h[i] = (sqrt(cx * cx + cy * cy) < DAM_RADIUS) ? DAM_DEPTH : 0.0;
+			grid.qx[i] = 0.0;
+			grid.qy[i] = 0.0;
+			grid.nm_rough[i] = MANNING;
+			grid.timeStep[i] = (grid.h[i] > TOL_H) ? CFL * std::min(s.dxl, s.dyl) / sqrt(GRAVITY * grid.h[i]) : BIG_NUMBER;
+		}
+
+	return grid;
+}
+
+double seconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+	{
+		printf("usage: %s [size] [steps] [steps_per_tile] [threads] [l2_kb]\n", argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	Settings s;
+	s.size = (argc > 1) ? atoi(argv[1]) : 2048;
+	s.steps = (argc > 2) ? atoi(argv[2]) : 40;
+	s.steps_per_tile = (argc > 3) ? atoi(argv[3]) : 2;
+	s.threads = (argc > 4) ? atoi(argv[4]) : std::max(1, (int)std::thread::hardware_concurrency());
+	int l2_kb = (argc > 5) ? atoi(argv[5]) : 1024;
+
+	if (s.size < 8 || s.steps < 1 || s.steps_per_tile < 1 || s.threads < 1 || l2_kb < 16)
+	{
+		fprintf(stderr, "Error: invalid arguments, see %s --help\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// the steps are taken in whole blocks of steps_per_tile
+	s.steps = ((s.steps + s.steps_per_tile - 1) / s.steps_per_tile) * s.steps_per_tile;
+	s.dxl = DOMAIN_SIZE / s.size;
+	s.dyl = DOMAIN_SIZE / s.size;
+
+	// the largest tile whose buffer (with its halo) takes half of the L2 cache
+	int buffer = (int)sqrt((double)l2_kb * 1024.0 / 2.0 / Fields::bytesPerCell());
+	s.tile = std::max(8, buffer - 4 * s.steps_per_tile);
+	s.tile = std::min(s.tile, s.size);
+
+	printf("Dam-break, %d x %d cells, %d steps, %d steps per tile, %d threads, tiles of %d x %d cells (L2 %d KB)\n",
+		s.size, s.size, s.steps, s.steps_per_tile, s.threads, s.tile, s.tile, l2_kb);
+
+	// layers
+	Fields layers = damBreak(s);
+	auto start = std::chrono::steady_clock::now();
+	for (int step = 0; step < s.steps; step += s.steps_per_tile)
+	{
+		double dt = minTimeStep(layers.timeStep) / s.steps_per_tile;
+		for (int i = 0; i < s.steps_per_tile; i++)
+			layerStep(layers, dt, s);
+	}
+	double time_layers = seconds(start);
+
+	// tiled
+	Fields tiled = damBreak(s);
+	Fields tiled_next = tiled;
+	std::vector<Fields> locals(s.threads);
+	start = std::chrono::steady_clock::now();
+	for (int step = 0; step < s.steps; step += s.steps_per_tile)
+	{
+		double dt = minTimeStep(tiled.timeStep) / s.steps_per_tile;
+		tiledSteps(tiled, tiled_next, locals, dt, s);
+	}
+	double time_tiled = seconds(start);
+
+	double max_diff = 0.0;
+	for (size_t i = 0; i < layers.h.size(); i++)
+	{
+		max_diff = std::max(max_diff, fabs(layers.h[i] - tiled.h[i]));
+		max_diff = std::max(max_diff, fabs(layers.qx[i] - tiled.qx[i]));
+		max_diff = std::max(max_diff, fabs(layers.qy[i] - tiled.qy[i]));
+	}
+
+	double updates = (double)s.size * s.size * s.steps;
+	printf("layers: %f s, %.1f M cell updates/s, effective bandwidth %.2f GB/s\n",
+		time_layers, updates / time_layers / 1.0e6, updates * BYTES_PER_CELL_STEP / time_layers / 1.0e9);
+	printf("tiled:  %f s, %.1f M cell updates/s, effective bandwidth %.2f GB/s (%.2fx)\n",
+		time_tiled, updates / time_tiled / 1.0e6, updates * BYTES_PER_CELL_STEP / time_tiled / 1.0e9, time_layers / time_tiled);
+	printf("max |tiled - layers| of h, qx and qy = %e\n", max_diff);
+
+	// (also fails on NaN)
+	if (!(max_diff == 0.0))
+	{
+		fprintf(stderr, "Error: the tiled execution differs from the layers\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
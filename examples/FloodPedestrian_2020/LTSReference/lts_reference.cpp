@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+// NOTE: to compile with g++, run "g++ -std=c++11 -O2 lts_reference.cpp -o lts_reference"
+
+// CPU reference of the local time stepping of the flood model (lts_on in XMLModelFile.xml). A radial dam-break onto a shallow
+// floodplain (flat bed, closed reflective box) is run once with the global CFL time-step and once with local time stepping,
+// following the update of the FloodCell agents in functions.c: the levels of LTS_Level smoothed as in ProcessWetDryMessage, the
+// face levels, flux accumulation and windows of ProcessSpaceOperatorMessage. It reports the water volume of both runs (no water
+// enters or leaves the box, so any change is a conservation error), the number of flux evaluations and the difference of the
+// depths. The exit status is EXIT_FAILURE if the volume is not conserved by local time stepping (or the run became unstable).
+//
+// usage: lts_reference [width] [height] [lts_max_level (0 to 2)] [end_time]
+
+#define GRAVITY 9.80665
+#define CFL 0.5
+#define TOL_H 10.0e-4
+#define BIG_NUMBER 800000
+
+// Relative change of the water volume taken as round off
+#define VOLUME_TOLERANCE 1.0e-10
+
+#define DOMAIN_SIZE 100.0		// the box is DOMAIN_SIZE x DOMAIN_SIZE metres
+#define DAM_RADIUS 20.0
+#define DAM_DEPTH 2.0
+#define FLOODPLAIN_DEPTH 0.05
+
+// The flow and local time stepping state of a flood agent
+struct Cell
+{
+	double h = 0.0;
+	double qx = 0.0;
+	double qy = 0.0;
+	double timeStep = BIG_NUMBER;
+
+	int lts_level = 0;
+	int lts_level_min = 0;
+	double acc_h = 0.0;
+	double acc_qx = 0.0;
+	double acc_qy = 0.0;
+};
+
+struct Flux
+{
+	double x, y, z;
+};
+
+struct Grid
+{
+	int width;
+	int height;
+	double dxl;
+	double dyl;
+	std::vector<Cell> cells;
+
+	Cell& at(int x, int y) { return cells[y * width + x]; }
+	const Cell& at(int x, int y) const { return cells[y * width + x]; }
+};
+
+
+/////////////////////////////////////////////////// Shallow water solver (as functions.c) ///////////////////////////////////////////////////
+
+Flux F_SWE(double hh, double qx, double qy)
+{
+	if (hh <= TOL_H)
+		return Flux{ 0.0, 0.0, 0.0 };
+
+	return Flux{ qx, (pow(qx, 2.0) / hh) + ((GRAVITY / 2.0) * pow(hh, 2.0)), (qx * qy) / hh };
+}
+
+// HLL flux in x direction as hll_x, the normal momentum is qx. hll_y is the same with qx and qy (and the flux components) swapped.
+Flux hll_x(double h_L, double h_R, double qx_L, double qx_R, double qy_L, double qy_R)
+{
+	Flux F_face = { 0.0, 0.0, 0.0 };
+
+	if ((h_L <= TOL_H) && (h_R <= TOL_H))
+		return F_face;
+
+	double u_L = 0.0, v_L = 0.0, u_R = 0.0, v_R = 0.0;
+
+	if (h_L <= TOL_H)
+		h_L = 0.0;
+	else
+	{
+		u_L = qx_L / h_L;
+		v_L = qy_L / h_L;
+	}
+
+	if (h_R <= TOL_H)
+		h_R = 0.0;
+	else
+	{
+		u_R = qx_R / h_R;
+		v_R = qy_R / h_R;
+	}
+
+	double a_L = sqrt(GRAVITY * h_L);
+	double a_R = sqrt(GRAVITY * h_R);
+
+	double h_star = pow(((a_L + a_R) / 2.0 + (u_L - u_R) / 4.0), 2) / GRAVITY;
+	double u_star = (u_L + u_R) / 2.0 + a_L - a_R;
+	double a_star = sqrt(GRAVITY * h_star);
+
+	double s_L = (h_L <= TOL_H) ? u_R - (2.0 * a_R) : std::min(u_L - a_L, u_star - a_star);
+	double s_R = (h_R <= TOL_H) ? u_L + (2.0 * a_L) : std::max(u_R + a_R, u_star + a_star);
+
+	double s_M = ((s_L * h_R * (u_R - s_R)) - (s_R * h_L * (u_L - s_L))) / (h_R * (u_R - s_R) - (h_L * (u_L - s_L)));
+
+	Flux F_L = F_SWE(h_L, qx_L, qy_L);
+	Flux F_R = F_SWE(h_R, qx_R, qy_R);
+
+	if (s_L >= 0.0)
+	{
+		F_face = F_L;
+	}
+	else if ((s_L < 0.0) && s_R >= 0.0)
+	{
+		double F1_M = ((s_R * F_L.x) - (s_L * F_R.x) + s_L * s_R * (h_R - h_L)) / (s_R - s_L);
+		double F2_M = ((s_R * F_L.y) - (s_L * F_R.y) + s_L * s_R * (qx_R - qx_L)) / (s_R - s_L);
+
+		if ((s_L < 0.0) && (s_M >= 0.0))
+			F_face = Flux{ F1_M, F2_M, F1_M * v_L };
+		else if ((s_M < 0.0) && (s_R >= 0.0))
+			F_face = Flux{ F1_M, F2_M, F1_M * v_R };
+	}
+	else if (s_R < 0)
+	{
+		F_face = F_R;
+	}
+
+	return F_face;
+}
+
+Flux hll_y(double h_S, double h_N, double qx_S, double qx_N, double qy_S, double qy_N)
+{
+	Flux G = hll_x(h_S, h_N, qy_S, qy_N, qx_S, qx_N);
+	return Flux{ G.x, G.z, G.y };
+}
+
+// The fluxes of the four faces of a cell, the walls of the box are reflective (BOUNDARY_*_STATUS 2)
+struct CellFluxes
+{
+	Flux FPlus, FMinus, GPlus, GMinus;
+};
+
+CellFluxes cellFluxes(const Grid& grid, int x, int y)
+{
+	const Cell& c = grid.at(x, y);
+	CellFluxes f;
+
+	if (x + 1 < grid.width)
+	{
+		const Cell& e = grid.at(x + 1, y);
+		f.FPlus = hll_x(c.h, e.h, c.qx, e.qx, c.qy, e.qy);
+	}
+	else
+		f.FPlus = hll_x(c.h, c.h, c.qx, -c.qx, c.qy, c.qy);
+
+	if (x > 0)
+	{
+		const Cell& w = grid.at(x - 1, y);
+		f.FMinus = hll_x(w.h, c.h, w.qx, c.qx, w.qy, c.qy);
+	}
+	else
+		f.FMinus = hll_x(c.h, c.h, -c.qx, c.qx, c.qy, c.qy);
+
+	if (y + 1 < grid.height)
+	{
+		const Cell& n = grid.at(x, y + 1);
+		f.GPlus = hll_y(c.h, n.h, c.qx, n.qx, c.qy, n.qy);
+	}
+	else
+		f.GPlus = hll_y(c.h, c.h, c.qx, c.qx, c.qy, -c.qy);
+
+	if (y > 0)
+	{
+		const Cell& s = grid.at(x, y - 1);
+		f.GMinus = hll_y(s.h, c.h, s.qx, c.qx, s.qy, c.qy);
+	}
+	else
+		f.GMinus = hll_y(c.h, c.h, c.qx, c.qx, -c.qy, c.qy);
+
+	return f;
+}
+
+// Applies the change of the flow of a cell and stores its CFL time-step, as UpdateFloodCell
+void updateCell(Cell& c, double dh, double dqx, double dqy, double dxl, double dyl)
+{
+	c.h += dh;
+	c.qx += dqx;
+	c.qy += dqy;
+
+	c.timeStep = BIG_NUMBER;
+
+	if (c.h <= TOL_H)
+	{
+		c.qx = 0.0;
+		c.qy = 0.0;
+	}
+	else
+	{
+		double up = c.qx / c.h;
+		double vp = c.qy / c.h;
+		c.timeStep = fmin(CFL * dxl / (fabs(up) + sqrt(GRAVITY * c.h)), CFL * dyl / (fabs(vp) + sqrt(GRAVITY * c.h)));
+	}
+}
+
+double minTimeStep(const Grid& grid)
+{
+	double dt = BIG_NUMBER;
+	for (const Cell& c : grid.cells)
+		dt = std::min(dt, c.timeStep);
+	return dt;
+}
+
+double volume(const Grid& grid)
+{
+	double v = 0.0;
+	for (const Cell& c : grid.cells)
+		v += c.h;
+	return v * grid.dxl * grid.dyl;
+}
+
+
+/////////////////////////////////////////////////// Time stepping ///////////////////////////////////////////////////
+
+// One step of the global CFL time-step dt, every cell is updated
+void globalStep(Grid& grid, double dt, long long& flux_evaluations)
+{
+	std::vector<CellFluxes> fluxes(grid.cells.size());
+
+	for (int y = 0; y < grid.height; y++)
+		for (int x = 0; x < grid.width; x++)
+			fluxes[y * grid.width + x] = cellFluxes(grid, x, y);
+
+	flux_evaluations += (long long)grid.cells.size();
+
+	for (size_t i = 0; i < grid.cells.size(); i++)
+	{
+		const CellFluxes& f = fluxes[i];
+		updateCell(grid.cells[i],
+			-(dt / grid.dxl) * (f.FPlus.x - f.FMinus.x) - (dt / grid.dyl) * (f.GPlus.x - f.GMinus.x),
+			-(dt / grid.dxl) * (f.FPlus.y - f.FMinus.y) - (dt / grid.dyl) * (f.GPlus.y - f.GMinus.y),
+			-(dt / grid.dxl) * (f.FPlus.z - f.FMinus.z) - (dt / grid.dyl) * (f.GPlus.z - f.GMinus.z),
+			grid.dxl, grid.dyl);
+	}
+}
+
+// Level of a cell as LTS_Level, dry cells are at level 0
+int ltsLevel(const Cell& c, double dt, int max_level)
+{
+	int level = 0;
+	if (c.h <= TOL_H)
+		return level;
+	while ((level < max_level) && (c.timeStep >= dt * (double)(2 << level)))
+		level++;
+	return level;
+}
+
+double faceTime(int substep, int level, double dt)
+{
+	return (substep % (1 << level) == 0) ? dt * (1 << level) : 0.0;
+}
+
+// One cycle of 2^max_level sub-steps of dt with local time stepping
+void ltsCycle(Grid& grid, double dt, int max_level, long long& flux_evaluations)
+{
+	int width = grid.width;
+	int height = grid.height;
+
+	// levels from the time-steps, at most one level coarser than any neighbour (PrepareWetDry and ProcessWetDryMessage)
+	std::vector<int> raw(grid.cells.size());
+	for (size_t i = 0; i < grid.cells.size(); i++)
+		raw[i] = ltsLevel(grid.cells[i], dt, max_level);
+
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+		{
+			int level = raw[y * width + x];
+			for (int j = std::max(0, y - 1); j <= std::min(height - 1, y + 1); j++)
+				for (int i = std::max(0, x - 1); i <= std::min(width - 1, x + 1); i++)
+					level = std::min(level, raw[j * width + i] + 1);
+			grid.at(x, y).lts_level = level;
+		}
+
+	// the finest face of each cell (ProcessSpaceOperatorMessage at the first sub-step)
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+		{
+			Cell& c = grid.at(x, y);
+			c.lts_level_min = c.lts_level;
+			if (x + 1 < width) c.lts_level_min = std::min(c.lts_level_min, grid.at(x + 1, y).lts_level);
+			if (x > 0) c.lts_level_min = std::min(c.lts_level_min, grid.at(x - 1, y).lts_level);
+			if (y + 1 < height) c.lts_level_min = std::min(c.lts_level_min, grid.at(x, y + 1).lts_level);
+			if (y > 0) c.lts_level_min = std::min(c.lts_level_min, grid.at(x, y - 1).lts_level);
+		}
+
+	int cycle = 1 << max_level;
+	for (int substep = 0; substep < cycle; substep++)
+	{
+		// the fluxes of all cells are taken from the flow at the start of the sub-step (as the messages of PrepareSpaceOperator)
+		std::vector<CellFluxes> fluxes(grid.cells.size());
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+			{
+				if (substep % (1 << grid.at(x, y).lts_level_min) == 0)
+				{
+					fluxes[y * width + x] = cellFluxes(grid, x, y);
+					flux_evaluations++;
+				}
+			}
+
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+			{
+				Cell& c = grid.at(x, y);
+
+				if (substep % (1 << c.lts_level_min) == 0)
+				{
+					int level_E = (x + 1 < width) ? std::min(c.lts_level, grid.at(x + 1, y).lts_level) : c.lts_level;
+					int level_W = (x > 0) ? std::min(c.lts_level, grid.at(x - 1, y).lts_level) : c.lts_level;
+					int level_N = (y + 1 < height) ? std::min(c.lts_level, grid.at(x, y + 1).lts_level) : c.lts_level;
+					int level_S = (y > 0) ? std::min(c.lts_level, grid.at(x, y - 1).lts_level) : c.lts_level;
+
+					double dt_E = faceTime(substep, level_E, dt);
+					double dt_W = faceTime(substep, level_W, dt);
+					double dt_N = faceTime(substep, level_N, dt);
+					double dt_S = faceTime(substep, level_S, dt);
+
+					const CellFluxes& f = fluxes[y * width + x];
+					c.acc_h += -(dt_E * f.FPlus.x - dt_W * f.FMinus.x) / grid.dxl - (dt_N * f.GPlus.x - dt_S * f.GMinus.x) / grid.dyl;
+					c.acc_qx += -(dt_E * f.FPlus.y - dt_W * f.FMinus.y) / grid.dxl - (dt_N * f.GPlus.y - dt_S * f.GMinus.y) / grid.dyl;
+					c.acc_qy += -(dt_E * f.FPlus.z - dt_W * f.FMinus.z) / grid.dxl - (dt_N * f.GPlus.z - dt_S * f.GMinus.z) / grid.dyl;
+				}
+
+				if ((substep + 1) % (1 << c.lts_level) == 0)
+				{
+					updateCell(c, c.acc_h, c.acc_qx, c.acc_qy, grid.dxl, grid.dyl);
+					c.acc_h = 0.0;
+					c.acc_qx = 0.0;
+					c.acc_qy = 0.0;
+				}
+			}
+	}
+}
+
+Grid damBreak(int width, int height)
+{
+	Grid grid;
+	grid.width = width;
+	grid.height = height;
+	grid.dxl = DOMAIN_SIZE / width;
+	grid.dyl = DOMAIN_SIZE / height;
+	grid.cells.resize((size_t)width * height);
+
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+		{
+			double cx = (x + 0.5) * grid.dxl - 0.5 * DOMAIN_SIZE;
+			double cy = (y + 0.5) * grid.dyl - 0.5 * DOMAIN_SIZE;
+			Cell& c = grid.at(x, y);
+			updateCell(c, (sqrt(cx * cx + cy * cy) < DAM_RADIUS) ? DAM_DEPTH : FLOODPLAIN_DEPTH, 0.0, 0.0, grid.dxl, grid.dyl);
+		}
+
+	return grid;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+	{
+		printf("usage: %s [width] [height] [lts_max_level (0 to 2)] [end_time]\n", argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	int width = (argc > 1) ? atoi(argv[1]) : 128;
+	int height = (argc > 2) ? atoi(argv[2]) : 128;
+	int max_level = (argc > 3) ? atoi(argv[3]) : 2;
+	double end_time = (argc > 4) ? atof(argv[4]) : 10.0;
+
+	// the model accepts lts_max_level 0 to 2, for which the single smoothing pass of the levels is enough
+	if (width < 2 || height < 2 || max_level < 0 || max_level > 2 || end_time <= 0.0)
+	{
+		fprintf(stderr, "Error: invalid arguments, see %s --help\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// local time stepping, cycles of 2^max_level sub-steps until end_time is passed
+	Grid lts = damBreak(width, height);
+	double volume_init = volume(lts);
+	long long lts_evaluations = 0;
+	double lts_time = 0.0;
+	int cycles = 0;
+
+	while (lts_time < end_time)
+	{
+		double dt = minTimeStep(lts);
+		ltsCycle(lts, dt, max_level, lts_evaluations);
+		lts_time += dt * (1 << max_level);
+		cycles++;
+	}
+
+	// the global time-step up to the same time
+	Grid global = damBreak(width, height);
+	long long global_evaluations = 0;
+	double global_time = 0.0;
+	int steps = 0;
+
+	while (global_time < lts_time)
+	{
+		double dt = std::min(minTimeStep(global), lts_time - global_time);
+		globalStep(global, dt, global_evaluations);
+		global_time += dt;
+		steps++;
+	}
+
+	double volume_lts = volume(lts);
+	double volume_global = volume(global);
+	double error_lts = fabs(volume_lts - volume_init) / volume_init;
+	double error_global = fabs(volume_global - volume_init) / volume_init;
+
+	double diff_h = 0.0;
+	double max_h = 0.0;
+	for (size_t i = 0; i < lts.cells.size(); i++)
+	{
+		diff_h += fabs(lts.cells[i].h - global.cells[i].h);
+		max_h = std::max(max_h, global.cells[i].h);
+	}
+	diff_h /= (double)lts.cells.size();
+
+	printf("Radial dam-break onto a floodplain, %d x %d cells, simulated time %f s\n", width, height, lts_time);
+	printf("global time-step: %d steps, %lld cell flux evaluations, relative volume error %e\n", steps, global_evaluations, error_global);
+	printf("local time-step:  %d cycles of %d sub-steps, %lld cell flux evaluations (%.1f%%), relative volume error %e\n",
+		cycles, 1 << max_level, lts_evaluations, 100.0 * lts_evaluations / (double)global_evaluations, error_lts);
+	printf("mean |h_lts - h_global| = %e m (maximum depth %f m)\n", diff_h, max_h);
+
+	// (also fails on NaN, where the solution has become unstable)
+	if (!(error_lts <= VOLUME_TOLERANCE))
+	{
+		fprintf(stderr, "Error: local time stepping does not conserve the volume of water\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,924 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <queue>
+
+// NOTE: to compile with g++, run "g++ -std=c++11 -O2 -pthread navmap_builder.cpp -o navmap_builder"
+
+// Headless builder of the navigation map (navmap agents) of the pedestrian model. It reads the walls, exits and obstacles
+// of the floor plan from a simple text file (see example.nav) and produces the same collision force field as 'Build It!' in
+// the Windows only FGPUGridNavPlanEditor (NavMap.build()), written straight into the initial state format. The exit force
+// fields follow the gradient of a distance field to each exit instead of the editor's per cell search back.
+// The grid is held in flat arrays and the exit layers, which are the most expensive part of the build, are computed in parallel.
+
+#define HELP_OPTION_SHORT "-h"
+#define HELP_OPTION_LONG "--help"
+
+// Default number of exit force fields of navmap agents (exit0_x ... exit9_y), must match NUM_EXITS in functions.c
+#define DEFAULT_MAX_EXITS 10
+
+enum PointType { WALKABLE = 0, WALL = 1, EXIT = 2, OBSTACLE = 3 };
+enum Degradation { LINEAR = 0, INVERSE_SQUARE = 1 };
+
+// A line or polygon of the floor plan, in the coordinates of the area
+struct Polyline
+{
+	std::vector<double> x;
+	std::vector<double> y;
+};
+
+// The floor plan and the build settings (defaults are those of FGPUGridNavPlanEditor)
+struct FloorPlan
+{
+	int width = 0;
+	int height = 0;
+	double area_x0 = 0.0, area_y0 = 0.0, area_x1 = 0.0, area_y1 = 0.0;
+	bool area_defined = false;
+
+	std::vector<Polyline> walls;
+	std::vector<Polyline> exits;
+	std::vector<Polyline> obstacles;
+
+	int wall_force_dist = 2;
+	double wall_force_max = 1.0;
+	double wall_force_min = 0.2;
+	Degradation wall_force_degrade = LINEAR;
+
+	int exit_force_dist = 2;
+	double exit_force_max = 1.0;
+	double exit_force_min = 1.0;
+	Degradation exit_force_degrade = LINEAR;
+};
+
+// The built navigation map
+struct NavMap
+{
+	int width = 0;
+	int height = 0;
+
+	std::vector<float> collision_x;
+	std::vector<float> collision_y;
+
+	std::vector<std::vector<float> > exit_x; // one layer per exit
+	std::vector<std::vector<float> > exit_y;
+	std::vector<int> exit_cell_count;
+	std::vector<int> exit_no; // 0 if the cell is not an exit, otherwise the exit number (exit 1 first)
+};
+
+
+/////////////////////////////////////////////////// Reading the floor plan ///////////////////////////////////////////////////
+
+Degradation parseDegradation(const char* value, int line_no)
+{
+	if (strcmp(value, "linear") == 0)
+		return LINEAR;
+	if (strcmp(value, "inverse_square") == 0)
+		return INVERSE_SQUARE;
+
+	fprintf(stderr, "Error: line %d: unknown force degradation '%s' (linear or inverse_square)\n", line_no, value);
+	exit(EXIT_FAILURE);
+}
+
+// Reads the floor plan file, one keyword per line followed by its values. Lines starting with '#' are comments.
+void readFloorPlan(const char* path, FloorPlan& plan)
+{
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not open floor plan file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<std::string> tokens;
+	char buffer[4096];
+	std::string line;
+	int line_no = 0;
+
+	while (fgets(buffer, sizeof(buffer), fp) != NULL)
+	{
+		line += buffer;
+		// long polylines may be longer than the buffer
+		if (line.back() != '\n' && !feof(fp))
+			continue;
+		line_no++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		tokens.clear();
+		char* token = strtok(&line[0], " \t\r\n,");
+		while (token != NULL)
+		{
+			tokens.push_back(token);
+			token = strtok(NULL, " \t\r\n,");
+		}
+		line.clear();
+
+		if (tokens.empty())
+			continue;
+
+		const std::string& key = tokens[0];
+		size_t values = tokens.size() - 1;
+
+		if (key == "wall" || key == "exit" || key == "obstacle")
+		{
+			if (values < 4 || values % 2 != 0)
+			{
+				fprintf(stderr, "Error: line %d: '%s' needs at least two x y points\n", line_no, key.c_str());
+				exit(EXIT_FAILURE);
+			}
+			Polyline polyline;
+			for (size_t i = 1; i < tokens.size(); i += 2)
+			{
+				polyline.x.push_back(atof(tokens[i].c_str()));
+				polyline.y.push_back(atof(tokens[i + 1].c_str()));
+			}
+			if (key == "wall")
+				plan.walls.push_back(polyline);
+			else if (key == "exit")
+				plan.exits.push_back(polyline);
+			else
+				plan.obstacles.push_back(polyline);
+			continue;
+		}
+
+		if (key == "size" && values == 2)
+		{
+			plan.width = atoi(tokens[1].c_str());
+			plan.height = atoi(tokens[2].c_str());
+		}
+		else if (key == "area" && values == 4)
+		{
+			plan.area_x0 = atof(tokens[1].c_str());
+			plan.area_y0 = atof(tokens[2].c_str());
+			plan.area_x1 = atof(tokens[3].c_str());
+			plan.area_y1 = atof(tokens[4].c_str());
+			plan.area_defined = true;
+		}
+		else if (key == "wall_force_dist" && values == 1)
+			plan.wall_force_dist = atoi(tokens[1].c_str());
+		else if (key == "wall_force_max" && values == 1)
+			plan.wall_force_max = atof(tokens[1].c_str());
+		else if (key == "wall_force_min" && values == 1)
+			plan.wall_force_min = atof(tokens[1].c_str());
+		else if (key == "wall_force_degrade" && values == 1)
+			plan.wall_force_degrade = parseDegradation(tokens[1].c_str(), line_no);
+		else if (key == "exit_force_dist" && values == 1)
+			plan.exit_force_dist = atoi(tokens[1].c_str());
+		else if (key == "exit_force_max" && values == 1)
+			plan.exit_force_max = atof(tokens[1].c_str());
+		else if (key == "exit_force_min" && values == 1)
+			plan.exit_force_min = atof(tokens[1].c_str());
+		else if (key == "exit_force_degrade" && values == 1)
+			plan.exit_force_degrade = parseDegradation(tokens[1].c_str(), line_no);
+		else if (key == "searchback_pixels" && values == 1)
+		{
+			// search back setting of the editor, accepted but not used as the exit forces are the gradient of a distance field
+		}
+		else
+		{
+			fprintf(stderr, "Error: line %d: unknown keyword or wrong number of values for '%s'\n", line_no, key.c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+	fclose(fp);
+
+	if (plan.width <= 0 || plan.height <= 0)
+	{
+		fprintf(stderr, "Error: the floor plan must define the grid size, e.g. 'size 64 64'\n");
+		exit(EXIT_FAILURE);
+	}
+	// by default the coordinates of the floor plan are grid cells
+	if (!plan.area_defined)
+	{
+		plan.area_x1 = plan.width;
+		plan.area_y1 = plan.height;
+	}
+	if (plan.area_x1 == plan.area_x0 || plan.area_y1 == plan.area_y0)
+	{
+		fprintf(stderr, "Error: the area of the floor plan must not be empty\n");
+		exit(EXIT_FAILURE);
+	}
+	if (plan.exits.empty())
+	{
+		fprintf(stderr, "Error: the floor plan does not define any exits\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+/////////////////////////////////////////////////// Rasterising the floor plan ///////////////////////////////////////////////////
+// NOTE: y of the grid is upwards, as the editor flips its image rows when building the grid
+
+int toCellX(const FloorPlan& plan, double x)
+{
+	int cx = (int)floor((x - plan.area_x0) / (plan.area_x1 - plan.area_x0) * plan.width);
+	return std::min(std::max(cx, 0), plan.width - 1);
+}
+
+int toCellY(const FloorPlan& plan, double y)
+{
+	int cy = (int)floor((y - plan.area_y0) / (plan.area_y1 - plan.area_y0) * plan.height);
+	return std::min(std::max(cy, 0), plan.height - 1);
+}
+
+// Draws a one cell wide line through the grid (Bresenham)
+void drawPolyline(const FloorPlan& plan, const Polyline& polyline, unsigned char value, std::vector<unsigned char>& grid)
+{
+	for (size_t i = 0; i + 1 < polyline.x.size(); i++)
+	{
+		int x0 = toCellX(plan, polyline.x[i]);
+		int y0 = toCellY(plan, polyline.y[i]);
+		int x1 = toCellX(plan, polyline.x[i + 1]);
+		int y1 = toCellY(plan, polyline.y[i + 1]);
+
+		int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+		int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+		int err = dx + dy;
+
+		while (true)
+		{
+			grid[x0 + y0 * plan.width] = value;
+			if (x0 == x1 && y0 == y1)
+				break;
+			int e2 = 2 * err;
+			if (e2 >= dy) { err += dy; x0 += sx; }
+			if (e2 <= dx) { err += dx; y0 += sy; }
+		}
+	}
+}
+
+// Fills the cells whose centre is inside the (closed) polygon
+void fillPolygon(const FloorPlan& plan, const Polyline& polygon, unsigned char value, std::vector<unsigned char>& grid)
+{
+	size_t n = polygon.x.size();
+	for (int y = 0; y < plan.height; y++)
+	{
+		double py = plan.area_y0 + (y + 0.5) / plan.height * (plan.area_y1 - plan.area_y0);
+		for (int x = 0; x < plan.width; x++)
+		{
+			double px = plan.area_x0 + (x + 0.5) / plan.width * (plan.area_x1 - plan.area_x0);
+			bool inside = false;
+			for (size_t i = 0, j = n - 1; i < n; j = i++)
+			{
+				if (((polygon.y[i] > py) != (polygon.y[j] > py)) &&
+					(px < (polygon.x[j] - polygon.x[i]) * (py - polygon.y[i]) / (polygon.y[j] - polygon.y[i]) + polygon.x[i]))
+					inside = !inside;
+			}
+			if (inside)
+				grid[x + y * plan.width] = value;
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////// Building the navigation map ///////////////////////////////////////////////////
+
+// Expands a frontier of cells by one ring in all 8 directions (getSurroundingPoints of the editor). Cells with a non zero mark are
+// covered or already in the ring and are skipped, new cells are marked with value. Unless ignore_walls is set only walkable and exit cells are
+// added and a diagonal step is only taken when neither of the straight cells next to it is a wall. If found_wall is given it is set when
+// any cell around the frontier is a wall.
+void expand(const std::vector<unsigned char>& grid, int width, int height, const std::vector<int>& frontier, bool ignore_walls,
+	std::vector<int>& mark, int value, std::vector<int>& ring, bool* found_wall)
+{
+	ring.clear();
+	for (size_t f = 0; f < frontier.size(); f++)
+	{
+		int px = frontier[f] % width;
+		int py = frontier[f] / width;
+		int bx = px - 1 >= 0 ? px - 1 : 0;
+		int by = py - 1 >= 0 ? py - 1 : 0;
+		int ex = px + 1 < width ? px + 1 : width - 1;
+		int ey = py + 1 < height ? py + 1 : height - 1;
+
+		for (int x = bx; x <= ex; x++)
+		{
+			for (int y = by; y <= ey; y++)
+			{
+				int cell = x + y * width;
+				unsigned char type = grid[cell];
+
+				if (!ignore_walls)
+				{
+					if (type == WALL && found_wall != NULL)
+						*found_wall = true;
+					if (type != WALKABLE && type != EXIT)
+						continue;
+					// diagonal steps must not cut the corner of a wall
+					if (x != px && y != py && (grid[x + py * width] == WALL || grid[px + y * width] == WALL))
+						continue;
+				}
+
+				if (mark[cell] == 0)
+				{
+					mark[cell] = value;
+					ring.push_back(cell);
+				}
+			}
+		}
+	}
+}
+
+bool isWalkable(unsigned char type)
+{
+	return type == WALKABLE || type == EXIT;
+}
+
+// Distance of cell (x, y) in the distance field of an exit, negative if it is outside of the grid, not walkable or its distance is not final
+double finalDistance(const std::vector<unsigned char>& grid, const std::vector<double>& distance, const std::vector<unsigned char>& done,
+	int width, int height, int x, int y)
+{
+	if (x < 0 || y < 0 || x >= width || y >= height)
+		return -1.0;
+	int cell = x + y * width;
+	return (done[cell] && isWalkable(grid[cell])) ? distance[cell] : -1.0;
+}
+
+// The smaller of two distances, ignoring negative (unknown) distances
+double upwindDistance(double a, double b)
+{
+	if (a < 0.0)
+		return b;
+	if (b < 0.0)
+		return a;
+	return std::min(a, b);
+}
+
+void normalise(double& x, double& y)
+{
+	double length = sqrt(x * x + y * y);
+	if (length > 0.0)
+	{
+		x /= length;
+		y /= length;
+	}
+}
+
+// Builds the collision (wall) force field, as the first part of NavMap.build() of the editor
+void buildCollisionForces(const FloorPlan& plan, NavMap& map)
+{
+	int width = plan.width;
+	int height = plan.height;
+	int cells = width * height;
+
+	// Draw walls and obstacles, but exits in walkable (white)
+	std::vector<unsigned char> grid(cells, WALKABLE);
+	for (size_t i = 0; i < plan.obstacles.size(); i++)
+	{
+		fillPolygon(plan, plan.obstacles[i], OBSTACLE, grid);
+		drawPolyline(plan, plan.obstacles[i], WALL, grid);
+	}
+	for (size_t i = 0; i < plan.walls.size(); i++)
+		drawPolyline(plan, plan.walls[i], WALL, grid);
+	for (size_t i = 0; i < plan.exits.size(); i++)
+		drawPolyline(plan, plan.exits[i], WALKABLE, grid);
+
+	std::vector<int> walls;
+	for (int c = 0; c < cells; c++)
+		if (grid[c] == WALL)
+			walls.push_back(c);
+
+	std::vector<double> wall_force(cells, 0.0);
+	std::vector<double> wall_x(cells, 0.0);
+	std::vector<double> wall_y(cells, 0.0);
+
+	// See if the cells are inside or outside, assuming that the first cell in the grid is always outside
+	std::vector<int> outside(cells, 0);
+	std::vector<int> frontier(1, 0);
+	std::vector<int> ring;
+	outside[0] = 1;
+	while (!frontier.empty())
+	{
+		expand(grid, width, height, frontier, false, outside, 1, ring, NULL);
+		frontier.swap(ring);
+	}
+	for (size_t i = 0; i < walls.size(); i++)
+		outside[walls[i]] = 1;
+
+	// Then builds the forces away from the walls, level by level
+	std::vector<int> level(cells, -1);
+	for (size_t i = 0; i < walls.size(); i++)
+		level[walls[i]] = 0;
+	std::vector<int> covered_mark(cells);
+	for (int c = 0; c < cells; c++)
+		covered_mark[c] = level[c] >= 0 ? 1 : 0;
+
+	frontier = walls;
+	for (int wall_level = 0; wall_level < plan.wall_force_dist; wall_level++)
+	{
+		expand(grid, width, height, frontier, false, covered_mark, 1, ring, NULL);
+		for (size_t r = 0; r < ring.size(); r++)
+			level[ring[r]] = wall_level + 1;
+
+		for (size_t r = 0; r < ring.size(); r++)
+		{
+			int p = ring[r];
+			int px = p % width, py = p / width;
+			double fx = 0.0, fy = 0.0;
+
+			for (int x = std::max(px - 1, 0); x <= std::min(px + 1, width - 1); x++)
+			{
+				for (int y = std::max(py - 1, 0); y <= std::min(py + 1, height - 1); y++)
+				{
+					int q = x + y * width;
+					// only the cells covered before this level
+					if (level[q] >= 0 && level[q] <= wall_level && (grid[q] == WALL || wall_force[q] > 0))
+					{
+						fx += px - x;
+						fy += py - y;
+					}
+				}
+			}
+
+			if (outside[p])
+			{
+				fx = -fx;
+				fy = -fy;
+			}
+			normalise(fx, fy);
+
+			int dist = wall_level + 1;
+			if (plan.wall_force_degrade == LINEAR)
+			{
+				wall_force[p] = ((1 - ((double)dist / (double)plan.wall_force_dist)) * (plan.wall_force_max - plan.wall_force_min)) + plan.wall_force_min;
+			}
+			else
+			{
+				double root_by = 2 * (dist - 1);
+				wall_force[p] = root_by > 0 ? pow(plan.wall_force_max, 1 / root_by) : plan.wall_force_max;
+			}
+			wall_x[p] = fx * wall_force[p];
+			wall_y[p] = fy * wall_force[p];
+		}
+		frontier.swap(ring);
+	}
+
+	// Fill the outside cells (including walls) with inward forces, ring by ring. inside_points holds the round in which
+	// each cell was added (1 for the inside cells), so the forces only look at the cells of the previous rounds.
+	std::vector<int> inside_points(cells, 0);
+	frontier.clear();
+	for (int c = 0; c < cells; c++)
+	{
+		if (!outside[c])
+		{
+			inside_points[c] = 1;
+			frontier.push_back(c);
+		}
+	}
+	for (int round = 2; ; round++)
+	{
+		expand(grid, width, height, frontier, true, inside_points, round, ring, NULL);
+		if (ring.empty())
+			break;
+
+		for (size_t r = 0; r < ring.size(); r++)
+		{
+			int p = ring[r];
+			int px = p % width, py = p / width;
+			double fx = 0.0, fy = 0.0;
+
+			for (int x = std::max(px - 1, 0); x <= std::min(px + 1, width - 1); x++)
+			{
+				for (int y = std::max(py - 1, 0); y <= std::min(py + 1, height - 1); y++)
+				{
+					int q = x + y * width;
+					if (inside_points[q] != 0 && inside_points[q] < round && (grid[q] == WALL || wall_force[q] > 0))
+					{
+						fx += x - px;
+						fy += y - py;
+					}
+				}
+			}
+			normalise(fx, fy);
+
+			wall_force[p] = plan.wall_force_max;
+			wall_x[p] = fx * wall_force[p];
+			wall_y[p] = fy * wall_force[p];
+		}
+		frontier.swap(ring);
+	}
+
+	// Fill all the obstacle cells with forces pointing out of the obstacle
+	std::vector<int> obstacle_covered(cells, 0);
+	for (size_t i = 0; i < walls.size(); i++)
+		obstacle_covered[walls[i]] = 1;
+	frontier = walls;
+	while (true)
+	{
+		// cells found in the search which are not obstacles are not covered and may be found again
+		expand(grid, width, height, frontier, true, obstacle_covered, 2, ring, NULL);
+
+		std::vector<int> obstacle_ring;
+		for (size_t r = 0; r < ring.size(); r++)
+		{
+			int p = ring[r];
+			if (grid[p] == OBSTACLE)
+				obstacle_ring.push_back(p);
+			else
+				obstacle_covered[p] = 0;
+		}
+
+		for (size_t r = 0; r < obstacle_ring.size(); r++)
+		{
+			int p = obstacle_ring[r];
+
+			int px = p % width, py = p / width;
+			double fx = 0.0, fy = 0.0;
+			for (int x = std::max(px - 1, 0); x <= std::min(px + 1, width - 1); x++)
+			{
+				for (int y = std::max(py - 1, 0); y <= std::min(py + 1, height - 1); y++)
+				{
+					int q = x + y * width;
+					if (inside_points[q] != 0 && obstacle_covered[q] == 1 && (grid[q] == WALL || grid[q] == OBSTACLE))
+					{
+						fx += x - px;
+						fy += y - py;
+					}
+				}
+			}
+			normalise(fx, fy);
+
+			wall_force[p] = plan.wall_force_max;
+			wall_x[p] = fx * wall_force[p];
+			wall_y[p] = fy * wall_force[p];
+		}
+
+		if (obstacle_ring.empty())
+			break;
+		for (size_t r = 0; r < obstacle_ring.size(); r++)
+			obstacle_covered[obstacle_ring[r]] = 1;
+		frontier.swap(obstacle_ring);
+	}
+
+	map.collision_x.resize(cells);
+	map.collision_y.resize(cells);
+	for (int c = 0; c < cells; c++)
+	{
+		map.collision_x[c] = (float)wall_x[c];
+		map.collision_y[c] = (float)wall_y[c];
+	}
+}
+
+// Builds the force field towards one exit. A single fast marching sweep from the exit cells solves the eikonal equation
+// |grad distance| = 1 over the walkable cells, which gives the walking distance of every cell to the exit, and the force of each
+// cell points down the gradient of this distance field. This replaces the per cell search back of NavMap.build() of the editor,
+// which visits a neighbourhood of searchback_pixels rings around every cell.
+void buildExitLayer(const FloorPlan& plan, int exit_id, NavMap& map, std::vector<int>& exit_cells)
+{
+	int width = plan.width;
+	int height = plan.height;
+	int cells = width * height;
+
+	// walls and outlines of the obstacles, all exits walkable (white) except this one
+	std::vector<unsigned char> grid(cells, WALKABLE);
+	for (size_t i = 0; i < plan.walls.size(); i++)
+		drawPolyline(plan, plan.walls[i], WALL, grid);
+	for (size_t i = 0; i < plan.obstacles.size(); i++)
+		drawPolyline(plan, plan.obstacles[i], WALL, grid);
+	for (size_t i = 0; i < plan.exits.size(); i++)
+		drawPolyline(plan, plan.exits[i], WALKABLE, grid);
+	drawPolyline(plan, plan.exits[exit_id], EXIT, grid);
+
+	exit_cells.clear();
+	for (int c = 0; c < cells; c++)
+		if (grid[c] == EXIT)
+			exit_cells.push_back(c);
+
+	std::vector<float>& exit_x = map.exit_x[exit_id];
+	std::vector<float>& exit_y = map.exit_y[exit_id];
+	exit_x.assign(cells, 0.0f);
+	exit_y.assign(cells, 0.0f);
+
+	// distance of each cell from the exit, negative until it is reached. A cell is done once its distance is final.
+	std::vector<double> distance(cells, -1.0);
+	std::vector<unsigned char> done(cells, 0);
+	typedef std::pair<double, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+	for (size_t i = 0; i < exit_cells.size(); i++)
+	{
+		distance[exit_cells[i]] = 0.0;
+		queue.push(Entry(0.0, exit_cells[i]));
+	}
+
+	const int step_x[4] = { -1, 1, 0, 0 };
+	const int step_y[4] = { 0, 0, -1, 1 };
+	while (!queue.empty())
+	{
+		Entry entry = queue.top();
+		queue.pop();
+		int p = entry.second;
+		if (done[p] || entry.first > distance[p])
+			continue;
+		done[p] = 1;
+
+		int px = p % width, py = p / width;
+		for (int s = 0; s < 4; s++)
+		{
+			int qx = px + step_x[s], qy = py + step_y[s];
+			if (qx < 0 || qy < 0 || qx >= width || qy >= height)
+				continue;
+			int q = qx + qy * width;
+			if (done[q] || !isWalkable(grid[q]))
+				continue;
+
+			// first order upwind solution from the smallest final distance of the x and y neighbours of q
+			double a = upwindDistance(finalDistance(grid, distance, done, width, height, qx - 1, qy), finalDistance(grid, distance, done, width, height, qx + 1, qy));
+			double b = upwindDistance(finalDistance(grid, distance, done, width, height, qx, qy - 1), finalDistance(grid, distance, done, width, height, qx, qy + 1));
+			double next_distance;
+			if (a < 0.0 || b < 0.0 || fabs(a - b) >= 1.0)
+				next_distance = upwindDistance(a, b) + 1.0;
+			else
+				next_distance = 0.5 * (a + b + sqrt(2.0 - (a - b) * (a - b)));
+
+			if (distance[q] < 0.0 || next_distance < distance[q])
+			{
+				distance[q] = next_distance;
+				queue.push(Entry(next_distance, q));
+			}
+		}
+	}
+
+	for (int p = 0; p < cells; p++)
+	{
+		if (distance[p] <= 0.0)
+			continue;
+
+		// one sided difference towards the neighbour closer to the exit along each axis (the gradient of the distance field)
+		int px = p % width, py = p / width;
+		double left = finalDistance(grid, distance, done, width, height, px - 1, py);
+		double right = finalDistance(grid, distance, done, width, height, px + 1, py);
+		double down = finalDistance(grid, distance, done, width, height, px, py - 1);
+		double up = finalDistance(grid, distance, done, width, height, px, py + 1);
+		double closest_x = upwindDistance(left, right);
+		double closest_y = upwindDistance(down, up);
+		double fx = 0.0, fy = 0.0;
+		if (closest_x >= 0.0 && closest_x < distance[p])
+			fx = (closest_x == left) ? closest_x - distance[p] : distance[p] - closest_x;
+		if (closest_y >= 0.0 && closest_y < distance[p])
+			fy = (closest_y == down) ? closest_y - distance[p] : distance[p] - closest_y;
+		normalise(fx, fy);
+
+		double exit_force;
+		if (plan.exit_force_degrade == LINEAR)
+		{
+			exit_force = std::max(((1 - (distance[p] / (double)plan.exit_force_dist)) * (plan.exit_force_max - plan.exit_force_min)) + plan.exit_force_min, plan.exit_force_min);
+		}
+		else
+		{
+			double root_by = 2 * distance[p];
+			exit_force = std::max(pow(plan.exit_force_max, 1 / root_by), plan.exit_force_min);
+		}
+
+		exit_x[p] = (float)(fx * exit_force);
+		exit_y[p] = (float)(fy * exit_force);
+	}
+}
+
+// Builds all exit layers, each thread taking the next exit which has not been built
+void buildExitForces(const FloorPlan& plan, NavMap& map, unsigned int threads)
+{
+	int exits = (int)plan.exits.size();
+	int cells = plan.width * plan.height;
+
+	map.exit_x.resize(exits);
+	map.exit_y.resize(exits);
+	std::vector<std::vector<int> > exit_cells(exits);
+
+	std::atomic<int> next_exit(0);
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&]() {
+			int exit_id;
+			while ((exit_id = next_exit++) < exits)
+				buildExitLayer(plan, exit_id, map, exit_cells[exit_id]);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	// a cell drawn by more than one exit belongs to the last one, as in the editor
+	map.exit_no.assign(cells, 0);
+	map.exit_cell_count.resize(exits);
+	for (int e = 0; e < exits; e++)
+	{
+		map.exit_cell_count[e] = (int)exit_cells[e].size();
+		for (size_t i = 0; i < exit_cells[e].size(); i++)
+			map.exit_no[exit_cells[e][i]] = e + 1;
+	}
+}
+
+
+/////////////////////////////////////////////////// Writing the initial states ///////////////////////////////////////////////////
+
+// Writes the per-exit cell count as an environment array padded with zeros to max_exits values
+std::string exitCellCountElement(const NavMap& map, int max_exits)
+{
+	std::string element = "<EXIT_CELL_COUNT>";
+	char value[32];
+	for (int e = 0; e < max_exits; e++)
+	{
+		snprintf(value, sizeof(value), "%s%d", e > 0 ? "," : "", e < (int)map.exit_cell_count.size() ? map.exit_cell_count[e] : 0);
+		element += value;
+	}
+	element += "</EXIT_CELL_COUNT>";
+	return element;
+}
+
+// Writes the navmap agents, x in the outer loop to keep the agent order of the editor output
+void writeNavmapAgents(FILE* fp, const NavMap& map)
+{
+	for (int x = 0; x < map.width; x++)
+	{
+		for (int y = 0; y < map.height; y++)
+		{
+			int c = x + y * map.width;
+			fprintf(fp, "<xagent>\n<name>navmap</name>\n<x>%d</x>\n<y>%d</y>\n<height>1</height>\n", x, y);
+			fprintf(fp, "<collision_x>%f</collision_x>\n<collision_y>%f</collision_y>\n", map.collision_x[c], map.collision_y[c]);
+			for (size_t e = 0; e < map.exit_x.size(); e++)
+			{
+				fprintf(fp, "<exit%d_x>%f</exit%d_x>\n<exit%d_y>%f</exit%d_y>\n", (int)e, map.exit_x[e][c], (int)e, (int)e, map.exit_y[e][c], (int)e);
+			}
+			fprintf(fp, "<exit_no>%d</exit_no>\n</xagent>\n", map.exit_no[c]);
+		}
+	}
+}
+
+std::string readFile(const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not open initial states file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	std::string contents;
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		contents.append(buffer, read);
+	fclose(fp);
+	return contents;
+}
+
+// Writes the navigation map as initial states. If merge_path is given the other agents and environment of that file are kept,
+// its navmap agents are replaced and its EXIT_CELL_COUNT is updated, so the output can be used as map.xml directly.
+void writeInitialStates(const char* output_path, const char* merge_path, const NavMap& map, int max_exits)
+{
+	std::string before = "<states>\n<itno>0</itno>\n<environment>\n" + exitCellCountElement(map, max_exits) + "\n</environment>\n";
+	std::string after = "</states>\n";
+
+	if (merge_path != NULL)
+	{
+		std::string states = readFile(merge_path);
+
+		// remove the existing navmap agents
+		std::string kept;
+		size_t position = 0;
+		while (true)
+		{
+			size_t start = states.find("<xagent>", position);
+			if (start == std::string::npos)
+				break;
+			size_t end = states.find("</xagent>", start);
+			if (end == std::string::npos)
+				break;
+			end += strlen("</xagent>");
+
+			kept.append(states, position, start - position);
+			std::string agent = states.substr(start, end - start);
+			if (agent.find("<name>navmap</name>") == std::string::npos)
+				kept += agent;
+			else if (end < states.size() && states[end] == '\n')
+				end++;
+			position = end;
+		}
+		kept.append(states, position, std::string::npos);
+
+		// update the exit cell counts in the environment
+		size_t count_start = kept.find("<EXIT_CELL_COUNT>");
+		size_t count_end = kept.find("</EXIT_CELL_COUNT>");
+		if (count_start != std::string::npos && count_end != std::string::npos)
+		{
+			kept.replace(count_start, count_end + strlen("</EXIT_CELL_COUNT>") - count_start, exitCellCountElement(map, max_exits));
+		}
+		else
+		{
+			size_t environment_end = kept.find("</environment>");
+			if (environment_end != std::string::npos)
+				kept.insert(environment_end, exitCellCountElement(map, max_exits) + "\n");
+		}
+
+		size_t states_end = kept.rfind("</states>");
+		if (states_end == std::string::npos)
+		{
+			fprintf(stderr, "Error: %s is not an initial states file (no </states>)\n", merge_path);
+			exit(EXIT_FAILURE);
+		}
+		before = kept.substr(0, states_end);
+		after = kept.substr(states_end);
+	}
+
+	FILE* fp = fopen(output_path, "w");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error: could not create output file %s\n", output_path);
+		exit(EXIT_FAILURE);
+	}
+	fputs(before.c_str(), fp);
+	writeNavmapAgents(fp, map);
+	fputs(after.c_str(), fp);
+	fclose(fp);
+}
+
+
+/////////////////////////////////////////////////// Main ///////////////////////////////////////////////////
+
+void printUsage(const char* executable)
+{
+	printf("\nusage: %s [-h] [--help] floor_plan output_path [-m initial_states] [-t threads] [-e max_exits]\n", executable);
+	printf("\n");
+	printf("required arguments:\n");
+	printf("  floor_plan           Path to the floor plan file (walls, exits and obstacles, see example.nav)\n");
+	printf("  output_path          Path to the initial states XML file to write\n");
+	printf("\n");
+	printf("options arguments:\n");
+	printf("  -h, --help           Output this help message.\n");
+	printf("  -m initial_states    Initial states XML file (e.g. map.xml) whose navmap agents are replaced and other data kept\n");
+	printf("  -t threads           Number of threads used to build the exit layers. Default is the number of hardware threads\n");
+	printf("  -e max_exits         Number of exits supported by the model (NUM_EXITS). Default is %d\n", DEFAULT_MAX_EXITS);
+}
+
+int main(int argc, char** argv)
+{
+	const char* floor_plan_path = NULL;
+	const char* output_path = NULL;
+	const char* merge_path = NULL;
+	unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+	int max_exits = DEFAULT_MAX_EXITS;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], HELP_OPTION_SHORT) == 0 || strcmp(argv[i], HELP_OPTION_LONG) == 0)
+		{
+			printUsage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			merge_path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threads = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+			max_exits = atoi(argv[++i]);
+		else if (floor_plan_path == NULL)
+			floor_plan_path = argv[i];
+		else if (output_path == NULL)
+			output_path = argv[i];
+		else
+		{
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (floor_plan_path == NULL || output_path == NULL)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FloorPlan plan;
+	readFloorPlan(floor_plan_path, plan);
+	if ((int)plan.exits.size() > max_exits)
+	{
+		fprintf(stderr, "Error: the floor plan has %d exits but the model supports %d (see -e)\n", (int)plan.exits.size(), max_exits);
+		exit(EXIT_FAILURE);
+	}
+
+	NavMap map;
+	map.width = plan.width;
+	map.height = plan.height;
+
+	printf("Building %dx%d navigation map with %d exits using %u threads\n", plan.width, plan.height, (int)plan.exits.size(), threads);
+	buildCollisionForces(plan, map);
+	buildExitForces(plan, map, std::min(threads, (unsigned int)plan.exits.size()));
+
+	printf("ExitId  Cells count\n");
+	for (size_t e = 0; e < map.exit_cell_count.size(); e++)
+	{
+		printf("%d %d\n", (int)e + 1, map.exit_cell_count[e]);
+		if (map.exit_cell_count[e] == 0)
+			printf("Warning: exit %d does not cover any cell\n", (int)e + 1);
+	}
+
+	writeInitialStates(output_path, merge_path, map, max_exits);
+	printf("Navigation map written to %s\n", output_path);
+
+	return EXIT_SUCCESS;
+}
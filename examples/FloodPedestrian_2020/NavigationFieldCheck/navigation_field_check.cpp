@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "../src/model/NavigationField.h"
+
+// NOTE: to compile with g++, run "g++ -std=c++11 -O2 navigation_field_check.cpp -o navigation_field_check"
+
+// CPU check of the incremental update of the navigation fields (updateNavigationField in src/model/NavigationField.h), as used by
+// updateNavigationFields in functions.c when nav_reroute_on is set. Random grids with walls and a few exits are solved once, then
+// edited over several rounds: obstacle edits (cells blocked and unblocked, as by sandbag dikes or water above nav_reroute_block_HR),
+// hazard edits (the cost of cells raised and lowered, as by the hazard rating of the water) and exit edits (exit cells blocked and
+// opened again). After each round the incrementally updated distances are compared with a full solve of the same costs, and every
+// cell whose distance changed must be listed in the dirty cells of its exit, as these are the only exit vectors that are re-derived.
+// The exit status is EXIT_FAILURE if any distance differs.
+//
+// usage: navigation_field_check [trials] [seed]
+
+#define MAX_GRID_SIZE 48
+#define MAX_EXITS 4
+#define ROUNDS 20
+
+// Largest difference between an incremental and a full solve taken as round off (distances are sums of up to a few thousand steps)
+#define DISTANCE_TOLERANCE 1.0e-6
+
+enum Edit { OBSTACLE_EDIT = 0, HAZARD_EDIT = 1, EXIT_EDIT = 2 };
+
+struct CheckResult
+{
+	long compared = 0;
+	long distance_errors = 0;
+	long dirty_errors = 0;
+	long updated = 0;
+	long edits[3] = { 0, 0, 0 };
+};
+
+int randomInt(int n)
+{
+	return rand() % n;
+}
+
+bool isInfinite(double distance)
+{
+	return distance >= NAV_FIELD_INFINITY;
+}
+
+// Builds a grid with random walls (cells not part of any exit's navigation map) and exits of up to 3 cells on random cells
+void buildField(NavigationField& field, std::vector<std::vector<int> >& exit_cells)
+{
+	int width = 4 + randomInt(MAX_GRID_SIZE - 4);
+	int height = 4 + randomInt(MAX_GRID_SIZE - 4);
+	int exits = 1 + randomInt(MAX_EXITS);
+	initNavigationField(field, width, height, exits);
+
+	std::vector<unsigned char> wall(width * height, 0);
+	for (int cell = 0; cell < width * height; cell++)
+		wall[cell] = randomInt(8) == 0;
+
+	exit_cells.assign(exits, std::vector<int>());
+	for (int e = 0; e < exits; e++)
+	{
+		int ex = randomInt(width);
+		int ey = randomInt(height);
+		for (int x = ex; x < ex + 3 && x < width; x++)
+			exit_cells[e].push_back(x + ey * width);
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				int cell = x + y * width;
+				bool source = (y == ey && x >= ex && x < ex + 3);
+				setNavigationFieldCell(field, e, x, y, !wall[cell], source);
+			}
+		}
+	}
+}
+
+// Applies one random edit of the given kind to the costs of the field
+void applyEdit(NavigationField& field, const std::vector<std::vector<int> >& exit_cells, Edit edit)
+{
+	int cells = field.width * field.height;
+	if (edit == OBSTACLE_EDIT)
+	{
+		// a small block of cells is blocked, or opened to a random cost
+		int x0 = randomInt(field.width);
+		int y0 = randomInt(field.height);
+		int x1 = std::min(x0 + 1 + randomInt(3), field.width);
+		int y1 = std::min(y0 + 1 + randomInt(3), field.height);
+		bool block = randomInt(2) == 0;
+		for (int y = y0; y < y1; y++)
+			for (int x = x0; x < x1; x++)
+				setNavigationFieldCost(field, x, y, block ? NAV_FIELD_BLOCKED : 1.0f + randomInt(4));
+	}
+	else if (edit == HAZARD_EDIT)
+	{
+		// the cost of a cell is raised or lowered to one of the hazard classes
+		int cell = randomInt(cells);
+		if (field.cost[cell] != NAV_FIELD_BLOCKED)
+			setNavigationFieldCost(field, cell % field.width, cell / field.width, 1.0f + 2.0f * randomInt(5));
+	}
+	else
+	{
+		// a cell of an exit is blocked or opened again
+		const std::vector<int>& exit = exit_cells[randomInt((int)exit_cells.size())];
+		int cell = exit[randomInt((int)exit.size())];
+		bool block = field.cost[cell] != NAV_FIELD_BLOCKED;
+		setNavigationFieldCost(field, cell % field.width, cell / field.width, block ? NAV_FIELD_BLOCKED : 1.0f);
+	}
+}
+
+// Compares the incrementally updated distances with a full solve of the same costs
+void compareWithFullSolve(const NavigationField& field, const std::vector<double>& previous_distance, int trial, int round, CheckResult& result)
+{
+	NavigationField full = field;
+	solveNavigationField(full);
+
+	int cells = field.width * field.height;
+	std::vector<unsigned char> dirty(cells);
+	for (int e = 0; e < field.exits; e++)
+	{
+		std::fill(dirty.begin(), dirty.end(), 0);
+		for (size_t i = 0; i < field.dirty_cells[e].size(); i++)
+			dirty[field.dirty_cells[e][i]] = 1;
+
+		for (int cell = 0; cell < cells; cell++)
+		{
+			int i = e * cells + cell;
+			double incremental = field.distance[i];
+			double solved = full.distance[i];
+			result.compared++;
+
+			if (isInfinite(incremental) != isInfinite(solved) || (!isInfinite(solved) && fabs(incremental - solved) > DISTANCE_TOLERANCE))
+			{
+				if (result.distance_errors++ < 10)
+					printf("Error: trial %d round %d exit %d cell (%d, %d): incremental distance %g, full solve %g\n",
+						trial, round, e + 1, cell % field.width, cell / field.width, incremental, solved);
+			}
+
+			bool changed = isInfinite(incremental) != isInfinite(previous_distance[i]) ||
+				(!isInfinite(incremental) && fabs(incremental - previous_distance[i]) > NAV_FIELD_TOLERANCE);
+			if (changed && !dirty[cell])
+			{
+				if (result.dirty_errors++ < 10)
+					printf("Error: trial %d round %d exit %d cell (%d, %d): distance changed but the cell is not dirty\n",
+						trial, round, e + 1, cell % field.width, cell / field.width);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int trials = (argc > 1) ? atoi(argv[1]) : 200;
+	unsigned int seed = (argc > 2) ? (unsigned int)atoi(argv[2]) : 1;
+	srand(seed);
+
+	CheckResult result;
+	for (int trial = 0; trial < trials; trial++)
+	{
+		NavigationField field;
+		std::vector<std::vector<int> > exit_cells;
+		buildField(field, exit_cells);
+		solveNavigationField(field);
+
+		for (int round = 0; round < ROUNDS; round++)
+		{
+			// each round mixes edits of all kinds, or (one round in four) only edits of one kind
+			int edits = 1 + randomInt(12);
+			int only = (randomInt(4) == 0) ? randomInt(3) : -1;
+			for (int i = 0; i < edits; i++)
+			{
+				Edit edit = (Edit)((only >= 0) ? only : randomInt(3));
+				applyEdit(field, exit_cells, edit);
+				result.edits[edit]++;
+			}
+
+			std::vector<double> previous_distance = field.distance;
+			result.updated += updateNavigationField(field);
+			compareWithFullSolve(field, previous_distance, trial, round, result);
+		}
+	}
+
+	printf("%d trials of %d rounds: %ld obstacle, %ld hazard and %ld exit edits, %ld distances updated incrementally\n",
+		trials, ROUNDS, result.edits[OBSTACLE_EDIT], result.edits[HAZARD_EDIT], result.edits[EXIT_EDIT], result.updated);
+	printf("%ld distances compared with a full solve: %ld differ, %ld changed without being dirty\n",
+		result.compared, result.distance_errors, result.dirty_errors);
+
+	if (result.distance_errors > 0 || result.dirty_errors > 0)
+		return EXIT_FAILURE;
+	printf("The incremental update matches the full solve\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,341 @@
+#! /usr/bin/env python3
+
+"""
+Synthetic benchmark suite of the flood-pedestrian model.
+
+Builds a console executable of the model (with trace=1) for each flood grid size, generates synthetic initial states for each
+combination of crowd size, flood phase, body effect and sandbagging, runs a fixed number of steps and writes the throughput of each
+layer (agent updates and cell updates per second, from trace_summary.csv) as JSON.
+
+    python3 benchmark.py build --sizes 128,256
+    python3 benchmark.py run --sizes 128,256 --crowds 1000,10000 --steps 200 -o results.json
+
+The grid sizes are compile time constants of the model, so each size has its own build in benchmarks/build/<size>, a copy of the
+model with the buffer sizes and grid dimensions of XMLModelFile.xml set to the size. Scenarios are written to benchmarks/runs.
+"""
+
+import argparse
+import itertools
+import json
+import math
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import time
+import xml.etree.ElementTree as ET
+
+BENCHMARK_DIR = os.path.dirname(os.path.abspath(__file__))
+EXAMPLE_DIR = os.path.dirname(BENCHMARK_DIR)
+FLAMEGPU_ROOT = os.path.dirname(os.path.dirname(EXAMPLE_DIR))
+MODEL_FILE = os.path.join(EXAMPLE_DIR, "src", "model", "XMLModelFile.xml")
+
+XMML = "{http://www.dcs.shef.ac.uk/~paul/XMML}"
+GPU = "{http://www.dcs.shef.ac.uk/~paul/XMMLGPU}"
+
+DEFAULT_SIZES = [128, 256, 512, 1024, 2048]
+DEFAULT_CROWDS = [1000, 10000, 100000, 1000000]
+PHASES = ["dry", "partial", "wet"]
+
+# Size of a flood cell in metres, the domain grows with the grid
+CELL_SIZE = 0.5
+# Depth of the water of the wet phases in metres, the partially wet phase is a dam break with water on the west half of the domain
+WET_DEPTH = 0.3
+NUM_EXITS = 10
+
+# Environment of the scenarios, constants which are not listed are 0. Pedestrians are not emitted (EMMISION_RATE_EXIT is 0) so the
+# crowd is the one of the initial states.
+BASE_ENVIRONMENT = {
+    "outputting_time": 1.0e9,
+    "outputting_time_interval": 0.0,
+    "dt_ped": 0.1,
+    "dt_flood": 0.01,
+    "auto_dt_on": 1,
+    "body_height": 1.75,
+    "init_speed": 1.3,
+    "brisk_speed": 2.0,
+    "inflow_start_time": 1.0e9,
+    "inflow_peak_time": 1.0e9,
+    "inflow_end_time": 1.0e9,
+    "INFLOW_BOUNDARY": 3,
+    "BOUNDARY_EAST_STATUS": 2,
+    "BOUNDARY_WEST_STATUS": 2,
+    "BOUNDARY_NORTH_STATUS": 2,
+    "BOUNDARY_SOUTH_STATUS": 2,
+    "evacuation_end_time": 1.0e9,
+    "evacuation_start_time": 1.0e9,
+    "sandbagging_start_time": 0.0,
+    "sandbagging_end_time": 1.0e9,
+    "sandbag_length": 0.5,
+    "sandbag_height": 0.1,
+    "sandbag_width": 0.25,
+    "extended_length": 0.0,
+    "sandbag_layers": 1,
+    "dike_height": 0.5,
+    "dike_width": 3.0,
+    "pickup_point": 1,
+    "drop_point": 2,
+    "pickup_duration": 30.0,
+    "drop_duration": 30.0,
+    "hero_percentage": 0.0,
+    "EMMISION_RATE_EXIT": [0.0] * NUM_EXITS,
+    "EXIT_PROBABILITY": [1, 1] + [0] * (NUM_EXITS - 2),
+    "EXIT_STATE": [1] * NUM_EXITS,
+    "PedHeight_163_170_probability": 0.5,
+    "PedHeight_170_186_probability": 0.5,
+    "PedAge_30_39_probability": 1.0,
+    "gender_female_probability": 0.5,
+    "gender_male_probability": 0.5,
+    "nav_reroute_interval": 10,
+    "nav_reroute_hazard_weight": 1.0,
+    "nav_reroute_block_HR": 1.5,
+    "nav_reroute_block_z0": 0.5,
+}
+
+
+def read_model():
+    """Reads the environment constants, agents, layers and discrete messages of the model file."""
+    root = ET.parse(MODEL_FILE).getroot()
+    constants = []
+    for variable in root.find(GPU + "environment").find(GPU + "constants"):
+        length = variable.find(XMML + "arrayLength")
+        constants.append((variable.find(XMML + "name").text, variable.find(XMML + "type").text, int(length.text) if length is not None else 0))
+    function_agents = {}
+    for agent in root.find(XMML + "xagents"):
+        agent_name = agent.find(XMML + "name").text
+        for function in agent.find(XMML + "functions"):
+            function_agents[function.find(XMML + "name").text] = agent_name
+    layers = []
+    for layer in root.find(XMML + "layers"):
+        layers.append([function.find(XMML + "name").text for function in layer])
+    return constants, function_agents, layers
+
+
+def next_pow2(value):
+    return 1 << max(0, int(math.ceil(math.log(value, 2))))
+
+
+def patch_model(text, size, agent_buffer):
+    """Sets the grid dimensions and buffer sizes of the discrete agents and messages to the grid size, and the buffer size of
+    continuous agents and spatially partitioned messages to agent_buffer."""
+    def patch_block(match):
+        block = match.group(0)
+        if "<gpu:width>" in block:
+            block = re.sub(r"<gpu:width>\s*\d+\s*</gpu:width>", "<gpu:width>{}</gpu:width>".format(size), block)
+            block = re.sub(r"<gpu:height>\s*\d+\s*</gpu:height>", "<gpu:height>{}</gpu:height>".format(size), block)
+            return re.sub(r"<gpu:bufferSize>\s*\d+\s*</gpu:bufferSize>", "<gpu:bufferSize>{}</gpu:bufferSize>".format(size * size), block)
+        return re.sub(r"<gpu:bufferSize>\s*\d+\s*</gpu:bufferSize>", "<gpu:bufferSize>{}</gpu:bufferSize>".format(agent_buffer), block)
+    text = re.sub(r"<gpu:xagent>.*?</gpu:xagent>", patch_block, text, flags=re.S)
+    return re.sub(r"<gpu:message>.*?</gpu:message>", patch_block, text, flags=re.S)
+
+
+def executable_name(size):
+    return "PedestrianNavigation_bench{}".format(size)
+
+
+def executable_path(size):
+    name = executable_name(size) + (".exe" if os.name == "nt" else "")
+    os_dir = "x64" if os.name == "nt" else "linux-x64"
+    return os.path.join(BENCHMARK_DIR, "build", str(size), "bin", os_dir, "Release_Console", name)
+
+
+def build(size, agent_buffer, jobs):
+    """Builds the console executable of a grid size from a copy of the model."""
+    build_dir = os.path.join(BENCHMARK_DIR, "build", str(size))
+    src_dir = os.path.join(build_dir, "src")
+    if os.path.isdir(src_dir):
+        shutil.rmtree(src_dir)
+    shutil.copytree(os.path.join(EXAMPLE_DIR, "src"), src_dir)
+    shutil.copy(os.path.join(EXAMPLE_DIR, "Makefile"), build_dir)
+    with open(MODEL_FILE, "r") as file:
+        model = file.read()
+    with open(os.path.join(src_dir, "model", "XMLModelFile.xml"), "w") as file:
+        file.write(patch_model(model, size, agent_buffer))
+
+    command = ["make", "-C", build_dir, "-j{}".format(jobs), "console", "trace=1",
+               "FLAMEGPU_ROOT={}/".format(FLAMEGPU_ROOT), "EXAMPLE={}".format(executable_name(size)),
+               "EXAMPLE_BIN_DIR={}".format(os.path.join(build_dir, "bin")), "EXAMPLE_BUILD_DIR={}".format(os.path.join(build_dir, "build"))]
+    print(" ".join(command))
+    if subprocess.call(command) != 0:
+        print("Error: build of grid size {} failed".format(size))
+        sys.exit(1)
+
+
+def format_value(value, type_name):
+    if isinstance(value, list):
+        return ",".join(format_value(v, type_name) for v in value)
+    if type_name in ("float", "double"):
+        return repr(float(value))
+    return str(int(value))
+
+
+def write_scenario(path, constants, size, crowd, phase, body, sandbag, seed):
+    """Writes the initial states of a scenario: a flat floor with a slight slope to the east, exits 1 and 2 on the west and east
+    walls and a crowd placed at random."""
+    rng = random.Random(seed)
+    extent = size * CELL_SIZE
+    environment = dict(BASE_ENVIRONMENT)
+    environment.update({"xmin": 0, "xmax": extent, "ymin": 0, "ymax": extent,
+                        "x1_boundary": 0, "x2_boundary": extent, "y1_boundary": 0, "y2_boundary": 0,
+                        "body_as_obstacle_on": body, "ped_roughness_effect_on": body, "sandbagging_on": sandbag,
+                        "hero_percentage": 0.5 if sandbag else 0.0,
+                        "dike_length": extent / 2, "initial_population": crowd})
+    environment["EXIT_CELL_COUNT"] = [size, size] + [0] * (NUM_EXITS - 2)
+
+    with open(path, "w") as file:
+        file.write("<states>\n<itno>0</itno>\n<environment>\n")
+        for name, type_name, length in constants:
+            value = environment.get(name, [0] * length if length else 0)
+            file.write("<{0}>{1}</{0}>\n".format(name, format_value(value, type_name)))
+        file.write("</environment>\n")
+
+        for y in range(size):
+            for x in range(size):
+                z0 = 0.001 * (size - x) * CELL_SIZE
+                h = 0.0
+                if phase == "wet" or (phase == "partial" and x < size // 2):
+                    h = WET_DEPTH
+                file.write("<xagent><name>FloodCell</name><inDomain>1</inDomain><x>{}</x><y>{}</y><z0>{:.6f}</z0><h>{}</h><nm_rough>0.01</nm_rough></xagent>\n".format(x, y, z0, h))
+
+        for y in range(size):
+            for x in range(size):
+                z0 = 0.001 * (size - x) * CELL_SIZE
+                h = WET_DEPTH if (phase == "wet" or (phase == "partial" and x < size // 2)) else 0.0
+                exit_no = 1 if x == 0 else (2 if x == size - 1 else 0)
+                file.write("<xagent><name>navmap</name><x>{}</x><y>{}</y><z0>{:.6f}</z0><h>{}</h><exit_no>{}</exit_no>"
+                           "<exit0_x>-1</exit0_x><exit0_y>0</exit0_y><exit1_x>1</exit1_x><exit1_y>0</exit1_y>"
+                           "<drop_point>{}</drop_point><nm_rough>0.01</nm_rough></xagent>\n".format(x, y, z0, h, exit_no, 1 if x == size // 2 else 0))
+
+        for i in range(crowd):
+            px = rng.uniform(-0.95, 0.95)
+            py = rng.uniform(-0.95, 0.95)
+            exit_no = 1 if px < 0 else 2
+            body_height = rng.uniform(1.6, 1.85)
+            file.write("<xagent><name>agent</name><x>{:.6f}</x><y>{:.6f}</y><exit_no>{}</exit_no><speed>{:.4f}</speed><lod>1</lod><animate>{:.4f}</animate>"
+                       "<animate_dir>1</animate_dir><HR_state>1</HR_state><hero_status>{}</hero_status><body_height>{:.4f}</body_height>"
+                       "<body_mass>{:.4f}</body_mass><gender>{}</gender><age>{}</age><excitement_speed>{:.4f}</excitement_speed></xagent>\n".format(
+                           px, py, exit_no, rng.uniform(1.2, 1.5), rng.random(), 1 if (sandbag and rng.random() < 0.5) else 0,
+                           body_height, body_height * body_height * 22.0, rng.randint(1, 2), rng.randint(18, 60), rng.uniform(1.8, 2.2)))
+        file.write("</states>\n")
+
+
+def read_trace_summary(path):
+    summary = {}
+    with open(path, "r") as file:
+        header = file.readline().strip().split(",")
+        for line in file:
+            values = dict(zip(header, line.strip().split(",")))
+            summary[values["name"]] = values
+    return summary
+
+
+def run_scenario(size, crowd, phase, body, sandbag, steps, device, seed, constants, function_agents, layers):
+    name = "grid{}_crowd{}_{}_body{}_sandbag{}".format(size, crowd, phase, body, sandbag)
+    run_dir = os.path.join(BENCHMARK_DIR, "runs", name)
+    if not os.path.isdir(run_dir):
+        os.makedirs(run_dir)
+    input_file = os.path.join(run_dir, "0.xml")
+    write_scenario(input_file, constants, size, crowd, phase, body, sandbag, seed)
+
+    command = [executable_path(size), input_file, str(steps), str(device), "0"]
+    start = time.time()
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as log:
+        status = subprocess.call(command, stdout=log, stderr=subprocess.STDOUT)
+    wall = time.time() - start
+    if status != 0:
+        print("Error: {} failed, see {}".format(name, os.path.join(run_dir, "stdout.txt")))
+        return None
+
+    summary = read_trace_summary(os.path.join(run_dir, "trace_summary.csv"))
+    cells = size * size
+    populations = {"FloodCell": cells, "navmap": cells, "agent": crowd}
+    result = {"scenario": name, "grid_size": size, "cells": cells, "crowd": crowd, "phase": phase, "body_effect": body,
+              "sandbagging": sandbag, "steps": steps, "wall_time_s": wall, "layers": []}
+    if "iteration" in summary:
+        result["iteration_mean_ms"] = float(summary["iteration"]["mean_ms"])
+    for index, functions in enumerate(layers):
+        layer = summary.get("layer{}".format(index + 1))
+        if layer is None:
+            continue
+        seconds = float(layer["mean_ms"]) / 1000.0
+        agents = [function_agents[f] for f in functions]
+        entry = {"layer": index + 1, "functions": functions, "mean_ms": float(layer["mean_ms"]), "p99_ms": float(layer["p99_ms"])}
+        # updates per second of the layer, pedestrians (as placed initially) and flood or navigation cells
+        if seconds > 0.0:
+            entry["agent_updates_per_s"] = crowd / seconds if "agent" in agents else 0.0
+            entry["cell_updates_per_s"] = cells / seconds if ("FloodCell" in agents or "navmap" in agents) else 0.0
+        entry["function_mean_ms"] = {}
+        for function in functions:
+            trace_name = "{}_{}".format(function_agents[function], function)
+            if trace_name in summary:
+                entry["function_mean_ms"][function] = float(summary[trace_name]["mean_ms"])
+        result["layers"].append(entry)
+    return result
+
+
+def parse_list(text, convert):
+    return [convert(value) for value in text.split(",") if value != ""]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Synthetic benchmarks of the flood-pedestrian model")
+    parser.add_argument("command", choices=["build", "run"], help="build the executables of the grid sizes or run the scenarios")
+    parser.add_argument("--sizes", default=",".join(str(s) for s in DEFAULT_SIZES), help="flood grid sizes (powers of 2)")
+    parser.add_argument("--crowds", default=",".join(str(c) for c in DEFAULT_CROWDS), help="numbers of pedestrians")
+    parser.add_argument("--phases", default=",".join(PHASES), help="initial water: dry, partial (west half wet) or wet")
+    parser.add_argument("--body", default="0,1", help="body_as_obstacle_on values")
+    parser.add_argument("--sandbag", default="0,1", help="sandbagging_on values")
+    parser.add_argument("--steps", type=int, default=100, help="number of steps of each run")
+    parser.add_argument("--device", type=int, default=0, help="CUDA device")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the placement of pedestrians")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="parallel make jobs")
+    parser.add_argument("-o", "--output", default=None, help="JSON results file, default stdout")
+    args = parser.parse_args()
+
+    sizes = parse_list(args.sizes, int)
+    crowds = parse_list(args.crowds, int)
+    phases = parse_list(args.phases, str)
+    for size in sizes:
+        if size & (size - 1) != 0:
+            print("Error: grid size {} is not a power of 2".format(size))
+            sys.exit(1)
+    for phase in phases:
+        if phase not in PHASES:
+            print("Error: unknown phase {}".format(phase))
+            sys.exit(1)
+
+    # the pedestrian buffer must hold the largest crowd
+    agent_buffer = max(16384, next_pow2(max(crowds)))
+
+    if args.command == "build":
+        for size in sizes:
+            build(size, agent_buffer, args.jobs)
+        return
+
+    constants, function_agents, layers = read_model()
+    results = []
+    for size, crowd, phase, body, sandbag in itertools.product(sizes, crowds, phases, parse_list(args.body, int), parse_list(args.sandbag, int)):
+        if not os.path.isfile(executable_path(size)):
+            print("Error: {} does not exist, run 'benchmark.py build --sizes {}' first".format(executable_path(size), size))
+            sys.exit(1)
+        # a denser crowd than one pedestrian per cell is not a realistic scenario
+        if crowd > size * size:
+            print("Skipping grid {} with crowd {}".format(size, crowd), file=sys.stderr)
+            continue
+        print("Running grid {} crowd {} {} body {} sandbag {}".format(size, crowd, phase, body, sandbag), file=sys.stderr)
+        result = run_scenario(size, crowd, phase, body, sandbag, args.steps, args.device, args.seed, constants, function_agents, layers)
+        if result is not None:
+            results.append(result)
+
+    output = json.dumps({"steps": args.steps, "results": results}, indent=2)
+    if args.output is None:
+        print(output)
+    else:
+        with open(args.output, "w") as file:
+            file.write(output + "\n")
+
+
+if __name__ == "__main__":
+    main()
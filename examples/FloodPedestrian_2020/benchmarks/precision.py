@@ -0,0 +1,170 @@
+#! /usr/bin/env python3
+
+"""
+Precision regression of the flood-pedestrian model.
+
+Builds the console executable of the model twice, with the real variables (the flood state and the flood messages, see
+gpu:precision in XMLModelFile.xml) stored as double and as float, runs the same dam-break scenario with both and reports the
+deviation of the flood envelope (maximum depth, maximum velocity and arrival time of the water of each flood cell) of the float
+run against the all-double run.
+
+    python3 precision.py build --size 128
+    python3 precision.py run --size 128 --steps 2000 -o precision.json
+
+The scenario is the partially wet phase of benchmark.py (water on the west half of the domain) with the flood envelope on.
+Builds are in benchmarks/build/precision_<precision>_<size> and runs in benchmarks/runs/precision_<precision>_<size>.
+"""
+
+import argparse
+import json
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+import benchmark
+
+PRECISIONS = ["double", "float"]
+
+
+def executable_name(precision, size):
+    return "PedestrianNavigation_{}{}".format(precision, size)
+
+
+def build_dir(precision, size):
+    return os.path.join(benchmark.BENCHMARK_DIR, "build", "precision_{}_{}".format(precision, size))
+
+
+def executable_path(precision, size):
+    name = executable_name(precision, size) + (".exe" if os.name == "nt" else "")
+    os_dir = "x64" if os.name == "nt" else "linux-x64"
+    return os.path.join(build_dir(precision, size), "bin", os_dir, "Release_Console", name)
+
+
+def build(precision, size, jobs):
+    """Builds the console executable of a precision from a copy of the model with gpu:precision set."""
+    directory = build_dir(precision, size)
+    src_dir = os.path.join(directory, "src")
+    if os.path.isdir(src_dir):
+        shutil.rmtree(src_dir)
+    shutil.copytree(os.path.join(benchmark.EXAMPLE_DIR, "src"), src_dir)
+    shutil.copy(os.path.join(benchmark.EXAMPLE_DIR, "Makefile"), directory)
+    with open(benchmark.MODEL_FILE, "r") as file:
+        model = benchmark.patch_model(file.read(), size, 16384)
+    model, count = re.subn(r"<gpu:precision>\s*\w+\s*</gpu:precision>", "<gpu:precision>{}</gpu:precision>".format(precision), model)
+    if count != 1:
+        print("Error: {} has no gpu:precision element".format(benchmark.MODEL_FILE))
+        sys.exit(1)
+    with open(os.path.join(src_dir, "model", "XMLModelFile.xml"), "w") as file:
+        file.write(model)
+
+    command = ["make", "-C", directory, "-j{}".format(jobs), "console",
+               "FLAMEGPU_ROOT={}/".format(benchmark.FLAMEGPU_ROOT), "EXAMPLE={}".format(executable_name(precision, size)),
+               "EXAMPLE_BIN_DIR={}".format(os.path.join(directory, "bin")), "EXAMPLE_BUILD_DIR={}".format(os.path.join(directory, "build"))]
+    print(" ".join(command))
+    if subprocess.call(command) != 0:
+        print("Error: build of {} precision failed".format(precision))
+        sys.exit(1)
+
+
+def read_envelope(path):
+    """Reads flood_envelope.csv (written by outputFloodEnvelope) as {(x, y): (depth, velocity, HR, arrival time)}."""
+    envelope = {}
+    with open(path, "r") as file:
+        file.readline()
+        for line in file:
+            values = line.strip().split(",")
+            if len(values) == 6:
+                envelope[(values[0], values[1])] = tuple(float(v) for v in values[2:])
+    return envelope
+
+
+def run(precision, size, crowd, steps, device, seed, constants):
+    run_dir = os.path.join(benchmark.BENCHMARK_DIR, "runs", "precision_{}_{}".format(precision, size))
+    if not os.path.isdir(run_dir):
+        os.makedirs(run_dir)
+    input_file = os.path.join(run_dir, "0.xml")
+    benchmark.write_scenario(input_file, constants, size, crowd, "partial", 0, 0, seed)
+
+    command = [executable_path(precision, size), input_file, str(steps), str(device), "0"]
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as log:
+        if subprocess.call(command, stdout=log, stderr=subprocess.STDOUT) != 0:
+            print("Error: the {} run failed, see {}".format(precision, os.path.join(run_dir, "stdout.txt")))
+            sys.exit(1)
+    return read_envelope(os.path.join(run_dir, "flood_envelope.csv"))
+
+
+def deviation(reference, other, column, mask=None):
+    """Maximum and mean absolute deviation and the relative L2 norm of the deviation of a column over the cells of mask."""
+    cells = [cell for cell in reference if (mask is None or mask(reference[cell], other[cell]))]
+    if not cells:
+        return {"cells": 0}
+    diffs = [abs(other[cell][column] - reference[cell][column]) for cell in cells]
+    norm = math.sqrt(sum(reference[cell][column] ** 2 for cell in cells))
+    return {"cells": len(cells), "max_abs": max(diffs), "mean_abs": sum(diffs) / len(diffs),
+            "relative_l2": math.sqrt(sum(d * d for d in diffs)) / norm if norm > 0.0 else 0.0}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Deviation of the float storage precision of the flood model against double")
+    parser.add_argument("command", choices=["build", "run"], help="build the executables of both precisions or run and compare them")
+    parser.add_argument("--size", type=int, default=128, help="flood grid size (power of 2)")
+    parser.add_argument("--crowd", type=int, default=1000, help="number of pedestrians")
+    parser.add_argument("--steps", type=int, default=1000, help="number of steps of each run")
+    parser.add_argument("--device", type=int, default=0, help="CUDA device")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the placement of pedestrians")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="parallel make jobs")
+    parser.add_argument("--tolerance", type=float, default=None, help="fail if the relative L2 deviation of depth or velocity is larger")
+    parser.add_argument("-o", "--output", default=None, help="JSON report file, default stdout")
+    args = parser.parse_args()
+
+    if args.size & (args.size - 1) != 0:
+        print("Error: grid size {} is not a power of 2".format(args.size))
+        sys.exit(1)
+
+    if args.command == "build":
+        for precision in PRECISIONS:
+            build(precision, args.size, args.jobs)
+        return
+
+    for precision in PRECISIONS:
+        if not os.path.isfile(executable_path(precision, args.size)):
+            print("Error: {} does not exist, run 'precision.py build --size {}' first".format(executable_path(precision, args.size), args.size))
+            sys.exit(1)
+
+    # the envelope is only kept with flood_envelope_on
+    benchmark.BASE_ENVIRONMENT["flood_envelope_on"] = 1
+    constants, _, _ = benchmark.read_model()
+    envelopes = {precision: run(precision, args.size, args.crowd, args.steps, args.device, args.seed, constants) for precision in PRECISIONS}
+    reference = envelopes["double"]
+    other = envelopes["float"]
+    if set(reference) != set(other):
+        print("Error: the envelopes of the runs have different cells")
+        sys.exit(1)
+
+    wet = lambda r, o: r[3] >= 0.0 and o[3] >= 0.0
+    report = {"grid_size": args.size, "steps": args.steps,
+              "max_depth": deviation(reference, other, 0),
+              "max_velocity": deviation(reference, other, 1),
+              "max_HR": deviation(reference, other, 2),
+              "arrival_time": deviation(reference, other, 3, wet),
+              "wet_cells_differing": sum(1 for cell in reference if (reference[cell][3] >= 0.0) != (other[cell][3] >= 0.0))}
+
+    output = json.dumps(report, indent=2)
+    if args.output is None:
+        print(output)
+    else:
+        with open(args.output, "w") as file:
+            file.write(output + "\n")
+
+    if args.tolerance is not None:
+        for column in ("max_depth", "max_velocity"):
+            if report[column].get("relative_l2", 0.0) > args.tolerance:
+                print("Error: the relative deviation of {} ({}) is larger than {}".format(column, report[column]["relative_l2"], args.tolerance))
+                sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,338 @@
+#ifndef _FRAME_RENDERER
+#define _FRAME_RENDERER
+
+// Host side rasteriser of RGB frames for console runs, which have no OpenGL context (see outputFrame in functions.c). Frames are
+// written as binary PPM or as PNG without any library: the PNG image data is compressed with the fixed Huffman codes of deflate,
+// matching each byte against the pixel to its left and the pixel above, which suits the flat colours of rasterised flood maps.
+
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <math.h>
+
+// File formats of writeFrame
+#define FRAME_FORMAT_PPM		0
+#define FRAME_FORMAT_PNG		1
+
+struct FrameImage
+{
+	int width;
+	int height;
+	std::vector<unsigned char> rgb;		/**< RGB of each pixel, row by row from the top of the image */
+};
+
+/** initFrameImage
+ * Allocates a frame, all pixels are black
+ * @param image the frame
+ * @param width width in pixels
+ * @param height height in pixels
+ */
+inline void initFrameImage(FrameImage& image, int width, int height)
+{
+	image.width = width;
+	image.height = height;
+	image.rgb.assign(width * height * 3, 0);
+}
+
+/** fillFrameRect
+ * Fills the pixels x0 <= x < x1, y0 <= y < y1 of a frame with a colour, clipped to the frame
+ * @param image the frame
+ * @param colour RGB colour
+ */
+inline void fillFrameRect(FrameImage& image, int x0, int y0, int x1, int y1, const unsigned char colour[3])
+{
+	x0 = (x0 < 0) ? 0 : x0;
+	y0 = (y0 < 0) ? 0 : y0;
+	x1 = (x1 > image.width) ? image.width : x1;
+	y1 = (y1 > image.height) ? image.height : y1;
+	for (int y = y0; y < y1; y++)
+	{
+		unsigned char* pixel = &image.rgb[(y * image.width + x0) * 3];
+		for (int x = x0; x < x1; x++, pixel += 3)
+		{
+			pixel[0] = colour[0];
+			pixel[1] = colour[1];
+			pixel[2] = colour[2];
+		}
+	}
+}
+
+/** fillFrameDisc
+ * Fills the pixels whose centre is within a disc, clipped to the frame
+ * @param image the frame
+ * @param cx x of the centre in pixels
+ * @param cy y of the centre in pixels (from the top)
+ * @param radius radius in pixels, at least the pixel containing the centre is filled
+ * @param colour RGB colour
+ */
+inline void fillFrameDisc(FrameImage& image, float cx, float cy, float radius, const unsigned char colour[3])
+{
+	int x0 = (int)floorf(cx - radius);
+	int x1 = (int)ceilf(cx + radius);
+	int y0 = (int)floorf(cy - radius);
+	int y1 = (int)ceilf(cy + radius);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			float dx = x + 0.5f - cx;
+			float dy = y + 0.5f - cy;
+			bool centre = (x == (int)floorf(cx)) && (y == (int)floorf(cy));
+			if ((centre || dx * dx + dy * dy <= radius * radius) && x >= 0 && x < image.width && y >= 0 && y < image.height)
+			{
+				unsigned char* pixel = &image.rgb[(y * image.width + x) * 3];
+				pixel[0] = colour[0];
+				pixel[1] = colour[1];
+				pixel[2] = colour[2];
+			}
+		}
+	}
+}
+
+/** frameColourRamp
+ * Linear interpolation of a colour map
+ * @param stops RGB colours of the map, evenly spaced from 0 to 1
+ * @param count number of stops (at least 2)
+ * @param t position in the map, clamped to 0..1
+ * @param colour interpolated RGB colour
+ */
+inline void frameColourRamp(const unsigned char stops[][3], int count, double t, unsigned char colour[3])
+{
+	t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+	double position = t * (count - 1);
+	int i = (int)position;
+	if (i >= count - 1)
+		i = count - 2;
+	double f = position - i;
+	for (int c = 0; c < 3; c++)
+		colour[c] = (unsigned char)(stops[i][c] + f * (stops[i + 1][c] - stops[i][c]) + 0.5);
+}
+
+/** writeFramePPM
+ * Writes a frame as a binary (P6) PPM file
+ * @param image the frame
+ * @param path file path of the image
+ * @return false if the file could not be written
+ */
+inline bool writeFramePPM(const FrameImage& image, const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+	fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+	bool written = fwrite(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+	return (fclose(file) == 0) && written;
+}
+
+// Bit writer of a deflate stream, bits are packed from the least significant bit of each byte
+struct FrameBitWriter
+{
+	std::vector<unsigned char>* out;
+	unsigned int buffer;
+	int bits;
+};
+
+inline void writeFrameBits(FrameBitWriter& writer, unsigned int value, int count)
+{
+	writer.buffer |= value << writer.bits;
+	writer.bits += count;
+	while (writer.bits >= 8)
+	{
+		writer.out->push_back((unsigned char)(writer.buffer & 0xFF));
+		writer.buffer >>= 8;
+		writer.bits -= 8;
+	}
+}
+
+// Huffman codes are sent from their most significant bit
+inline void writeFrameCode(FrameBitWriter& writer, unsigned int code, int length)
+{
+	unsigned int reversed = 0;
+	for (int i = 0; i < length; i++)
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	writeFrameBits(writer, reversed, length);
+}
+
+// Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+inline void writeFrameSymbol(FrameBitWriter& writer, int symbol)
+{
+	if (symbol < 144)
+		writeFrameCode(writer, 0x30 + symbol, 8);
+	else if (symbol < 256)
+		writeFrameCode(writer, 0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		writeFrameCode(writer, symbol - 256, 7);
+	else
+		writeFrameCode(writer, 0xC0 + symbol - 280, 8);
+}
+
+inline void writeFrameMatch(FrameBitWriter& writer, int length, int distance)
+{
+	static const int length_base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const int length_extra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const int distance_base[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const int distance_extra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	int l = 28;
+	while (length_base[l] > length)
+		l--;
+	writeFrameSymbol(writer, 257 + l);
+	writeFrameBits(writer, length - length_base[l], length_extra[l]);
+
+	int d = 29;
+	while (distance_base[d] > distance)
+		d--;
+	writeFrameCode(writer, d, 5);
+	writeFrameBits(writer, distance - distance_base[d], distance_extra[d]);
+}
+
+/** deflateFrameData
+ * Compresses data as a zlib stream of one fixed Huffman block, with matches at the given distances only
+ * @param data data to compress
+ * @param distances candidate match distances, each at most 32768
+ * @param out the zlib stream is appended to it
+ */
+inline void deflateFrameData(const std::vector<unsigned char>& data, const std::vector<int>& distances, std::vector<unsigned char>& out)
+{
+	FrameBitWriter writer = { &out, 0, 0 };
+	out.push_back(0x78);	// deflate with a 32K window
+	out.push_back(0x01);	// no preset dictionary, fastest compression
+
+	writeFrameBits(writer, 1, 1);	// final block
+	writeFrameBits(writer, 1, 2);	// fixed Huffman codes
+	size_t size = data.size();
+	size_t i = 0;
+	while (i < size)
+	{
+		int best_length = 0;
+		int best_distance = 0;
+		for (size_t d = 0; d < distances.size(); d++)
+		{
+			size_t distance = distances[d];
+			if (distance > i)
+				continue;
+			int length = 0;
+			while (length < 258 && i + length < size && data[i + length] == data[i + length - distance])
+				length++;
+			if (length > best_length)
+			{
+				best_length = length;
+				best_distance = (int)distance;
+			}
+		}
+		if (best_length >= 3)
+		{
+			writeFrameMatch(writer, best_length, best_distance);
+			i += best_length;
+		}
+		else
+		{
+			writeFrameSymbol(writer, data[i]);
+			i++;
+		}
+	}
+	writeFrameSymbol(writer, 256);	// end of block
+	if (writer.bits > 0)
+		writeFrameBits(writer, 0, 8 - writer.bits);
+
+	unsigned int a = 1, b = 0;
+	for (i = 0; i < size; i++)
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	unsigned int adler = (b << 16) | a;
+	for (int shift = 24; shift >= 0; shift -= 8)
+		out.push_back((unsigned char)(adler >> shift));
+}
+
+inline unsigned int frameCRC32(const unsigned char* data, size_t size, unsigned int crc)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+	}
+	return ~crc;
+}
+
+inline void writeFramePNGChunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+{
+	unsigned char header[8];
+	unsigned int size = (unsigned int)data.size();
+	for (int i = 0; i < 4; i++)
+	{
+		header[i] = (unsigned char)(size >> (24 - 8 * i));
+		header[4 + i] = (unsigned char)type[i];
+	}
+	unsigned int crc = frameCRC32(header + 4, 4, 0);
+	crc = frameCRC32(data.data(), data.size(), crc);
+	unsigned char footer[4];
+	for (int i = 0; i < 4; i++)
+		footer[i] = (unsigned char)(crc >> (24 - 8 * i));
+
+	fwrite(header, 1, 8, file);
+	fwrite(data.data(), 1, data.size(), file);
+	fwrite(footer, 1, 4, file);
+}
+
+/** writeFramePNG
+ * Writes a frame as an 8 bit RGB PNG file
+ * @param image the frame
+ * @param path file path of the image
+ * @return false if the file could not be written
+ */
+inline bool writeFramePNG(const FrameImage& image, const char* path)
+{
+	// rows of the image data start with their filter type, 0 (none)
+	int row_size = image.width * 3 + 1;
+	std::vector<unsigned char> rows((size_t)row_size * image.height);
+	for (int y = 0; y < image.height; y++)
+	{
+		rows[(size_t)y * row_size] = 0;
+		std::copy(image.rgb.begin() + (size_t)y * image.width * 3, image.rgb.begin() + (size_t)(y + 1) * image.width * 3, rows.begin() + (size_t)y * row_size + 1);
+	}
+	std::vector<int> distances(1, 3);
+	if (row_size <= 32768)
+		distances.push_back(row_size);
+	std::vector<unsigned char> idat;
+	deflateFrameData(rows, distances, idat);
+
+	std::vector<unsigned char> ihdr(13, 0);
+	for (int i = 0; i < 4; i++)
+	{
+		ihdr[i] = (unsigned char)(image.width >> (24 - 8 * i));
+		ihdr[4 + i] = (unsigned char)(image.height >> (24 - 8 * i));
+	}
+	ihdr[8] = 8;	// bit depth
+	ihdr[9] = 2;	// RGB
+
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(signature, 1, 8, file);
+	writeFramePNGChunk(file, "IHDR", ihdr);
+	writeFramePNGChunk(file, "IDAT", idat);
+	writeFramePNGChunk(file, "IEND", std::vector<unsigned char>());
+	bool written = !ferror(file);
+	return (fclose(file) == 0) && written;
+}
+
+/** writeFrame
+ * Writes a frame as an image file
+ * @param image the frame
+ * @param path file path of the image
+ * @param format FRAME_FORMAT_PPM or FRAME_FORMAT_PNG
+ * @return false if the file could not be written
+ */
+inline bool writeFrame(const FrameImage& image, const char* path, int format)
+{
+	if (format == FRAME_FORMAT_PNG)
+		return writeFramePNG(image, path);
+	return writeFramePPM(image, path);
+}
+
+#endif //_FRAME_RENDERER
@@ -0,0 +1,497 @@
+#ifndef _NAVIGATION_FIELD
+#define _NAVIGATION_FIELD
+
+// Host side distance fields of the navigation grid towards each exit, used to re-derive the exit vectors of navmap agents
+// when floodwater or sandbags change the cost of walking through cells (see updateNavigationFields in functions.c).
+// The distances are shortest paths over the 8 connected grid (a discrete approximation of the eikonal equation) with the cost
+// of a step taken as its length times the mean cost of the two cells. After the first solve only the cells whose cost changed
+// since the last update, and the cells whose shortest paths went through them, are solved again.
+
+#include <vector>
+#include <queue>
+#include <math.h>
+
+// Cost of a cell which cannot be walked through
+#define NAV_FIELD_BLOCKED		-1.0f
+#define NAV_FIELD_INFINITY		1.0e30
+// Tolerance used when comparing distances
+#define NAV_FIELD_TOLERANCE		1.0e-6
+
+struct NavigationField
+{
+	int width;
+	int height;
+	int exits;
+
+	std::vector<float> cost;					/**< cost of each cell (1 for a dry cell), NAV_FIELD_BLOCKED if it cannot be crossed */
+	std::vector<int> changed_cells;				/**< cells whose cost changed since the last update */
+	std::vector<unsigned char> changed;			/**< 1 for the cells in changed_cells */
+	std::vector<unsigned char> increased;		/**< 1 if the cost of a changed cell increased (or it became blocked or unblocked) */
+
+	// per exit arrays, index exit*width*height + cell
+	std::vector<unsigned char> walkable;		/**< cells which are part of the navigation map of the exit */
+	std::vector<unsigned char> source;			/**< cells of the exit itself */
+	std::vector<double> distance;				/**< cost of the shortest path to the exit */
+	std::vector<double> base_distance;			/**< distance with the costs of the first solve */
+	std::vector<int> parent;					/**< next cell on the shortest path, -1 for exit cells and unreachable cells */
+
+	std::vector<std::vector<int> > dirty_cells;	/**< per exit, cells whose distance or whose neighbours distance changed in the last update */
+};
+
+/** initNavigationField
+ * Allocates the navigation field of a grid with all cells walkable for no exit and a cost of 1
+ * @param field the navigation field
+ * @param width width of the grid
+ * @param height height of the grid
+ * @param exits number of exits
+ */
+inline void initNavigationField(NavigationField& field, int width, int height, int exits)
+{
+	int cells = width * height;
+	field.width = width;
+	field.height = height;
+	field.exits = exits;
+
+	field.cost.assign(cells, 1.0f);
+	field.changed_cells.clear();
+	field.changed.assign(cells, 0);
+	field.increased.assign(cells, 0);
+
+	field.walkable.assign(exits * cells, 0);
+	field.source.assign(exits * cells, 0);
+	field.distance.assign(exits * cells, NAV_FIELD_INFINITY);
+	field.base_distance.assign(exits * cells, NAV_FIELD_INFINITY);
+	field.parent.assign(exits * cells, -1);
+	field.dirty_cells.assign(exits, std::vector<int>());
+}
+
+/** setNavigationFieldCell
+ * Sets whether a cell belongs to the navigation map of an exit and if it is one of the cells of the exit
+ * @param field the navigation field
+ * @param exit exit index (starting at 0)
+ * @param x x position of the cell
+ * @param y y position of the cell
+ * @param walkable 1 if pedestrians heading to the exit can walk through the cell
+ * @param source 1 if the cell is part of the exit
+ */
+inline void setNavigationFieldCell(NavigationField& field, int exit, int x, int y, int walkable, int source)
+{
+	int i = exit * field.width * field.height + x + y * field.width;
+	field.walkable[i] = (walkable || source) ? 1 : 0;
+	field.source[i] = source ? 1 : 0;
+}
+
+/** setNavigationFieldCost
+ * Sets the cost of walking through a cell, recording it for the next update if it changed
+ * @param field the navigation field
+ * @param x x position of the cell
+ * @param y y position of the cell
+ * @param cost cost of the cell (1 or more), or NAV_FIELD_BLOCKED
+ */
+inline void setNavigationFieldCost(NavigationField& field, int x, int y, float cost)
+{
+	int cell = x + y * field.width;
+	float old_cost = field.cost[cell];
+	if (old_cost == cost)
+		return;
+
+	field.cost[cell] = cost;
+	if (!field.changed[cell])
+	{
+		field.changed[cell] = 1;
+		field.changed_cells.push_back(cell);
+	}
+	// blocking or unblocking a cell also changes the diagonal steps past it, which is handled as an increase
+	if (cost == NAV_FIELD_BLOCKED || old_cost == NAV_FIELD_BLOCKED || cost > old_cost)
+		field.increased[cell] = 1;
+}
+
+/** navigationFieldStep
+ * Cost of the step between two neighbouring cells for an exit
+ * @return the cost of the step or a negative value if the step is not possible
+ */
+inline double navigationFieldStep(const NavigationField& field, int offset, int from, int to)
+{
+	float from_cost = field.cost[from];
+	float to_cost = field.cost[to];
+	if (!field.walkable[offset + to] || from_cost == NAV_FIELD_BLOCKED || to_cost == NAV_FIELD_BLOCKED)
+		return -1.0;
+
+	int dx = (to % field.width) - (from % field.width);
+	int dy = (to / field.width) - (from / field.width);
+	double length = 1.0;
+	if (dx != 0 && dy != 0)
+	{
+		// diagonal steps must not cut the corner of a cell which can not be walked through (as in the navigation map builder)
+		int corner_a = (from / field.width) * field.width + (to % field.width);
+		int corner_b = (to / field.width) * field.width + (from % field.width);
+		if (!field.walkable[offset + corner_a] || !field.walkable[offset + corner_b] ||
+			field.cost[corner_a] == NAV_FIELD_BLOCKED || field.cost[corner_b] == NAV_FIELD_BLOCKED)
+			return -1.0;
+		length = 1.41421356237;
+	}
+	return length * 0.5 * (from_cost + to_cost);
+}
+
+typedef std::pair<double, int> NavigationFieldEntry;
+typedef std::priority_queue<NavigationFieldEntry, std::vector<NavigationFieldEntry>, std::greater<NavigationFieldEntry> > NavigationFieldQueue;
+
+/** relaxNavigationField
+ * Propagates the distances of the queued cells of an exit (Dijkstra), recording each cell whose distance is changed
+ */
+inline void relaxNavigationField(NavigationField& field, int exit, NavigationFieldQueue& queue, std::vector<int>& updated)
+{
+	int offset = exit * field.width * field.height;
+	while (!queue.empty())
+	{
+		NavigationFieldEntry entry = queue.top();
+		queue.pop();
+		int cell = entry.second;
+		if (entry.first > field.distance[offset + cell])
+			continue;
+
+		int cx = cell % field.width;
+		int cy = cell / field.width;
+		for (int y = cy - 1; y <= cy + 1; y++)
+		{
+			for (int x = cx - 1; x <= cx + 1; x++)
+			{
+				if (x < 0 || y < 0 || x >= field.width || y >= field.height || (x == cx && y == cy))
+					continue;
+				int next = x + y * field.width;
+				double step = navigationFieldStep(field, offset, cell, next);
+				if (step < 0.0)
+					continue;
+				double next_distance = entry.first + step;
+				if (next_distance < field.distance[offset + next] - NAV_FIELD_TOLERANCE)
+				{
+					field.distance[offset + next] = next_distance;
+					field.parent[offset + next] = cell;
+					updated.push_back(next);
+					queue.push(NavigationFieldEntry(next_distance, next));
+				}
+			}
+		}
+	}
+}
+
+/** markNavigationFieldDirty
+ * Adds the updated cells of an exit and their neighbours (whose direction depends on them) to the dirty cells of the exit
+ */
+inline void markNavigationFieldDirty(NavigationField& field, int exit, const std::vector<int>& updated, std::vector<unsigned char>& mark)
+{
+	std::vector<int>& dirty = field.dirty_cells[exit];
+	dirty.clear();
+	for (size_t i = 0; i < updated.size(); i++)
+	{
+		int cx = updated[i] % field.width;
+		int cy = updated[i] / field.width;
+		for (int y = cy - 1; y <= cy + 1; y++)
+		{
+			for (int x = cx - 1; x <= cx + 1; x++)
+			{
+				if (x < 0 || y < 0 || x >= field.width || y >= field.height)
+					continue;
+				int cell = x + y * field.width;
+				if (!mark[cell])
+				{
+					mark[cell] = 1;
+					dirty.push_back(cell);
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < dirty.size(); i++)
+		mark[dirty[i]] = 0;
+}
+
+/** addNavigationFieldChildren
+ * Marks and adds the children of a cell in the shortest path tree of an exit (the neighbours whose parent it is) to a list
+ */
+inline void addNavigationFieldChildren(const NavigationField& field, int offset, int cell, std::vector<unsigned char>& mark, std::vector<int>& list)
+{
+	int cx = cell % field.width;
+	int cy = cell / field.width;
+	for (int y = cy - 1; y <= cy + 1; y++)
+	{
+		for (int x = cx - 1; x <= cx + 1; x++)
+		{
+			if (x < 0 || y < 0 || x >= field.width || y >= field.height)
+				continue;
+			int child = x + y * field.width;
+			if (!mark[child] && field.parent[offset + child] == cell)
+			{
+				mark[child] = 1;
+				list.push_back(child);
+			}
+		}
+	}
+}
+
+/** solveNavigationField
+ * Solves the distances of all exits from scratch with the current costs and keeps them as the base distances.
+ * The exit vectors of the navigation map are kept wherever the distances match the base distances.
+ * @param field the navigation field
+ */
+inline void solveNavigationField(NavigationField& field)
+{
+	int cells = field.width * field.height;
+	std::vector<int> updated;
+	for (int exit = 0; exit < field.exits; exit++)
+	{
+		int offset = exit * cells;
+		NavigationFieldQueue queue;
+		updated.clear();
+		for (int cell = 0; cell < cells; cell++)
+		{
+			field.distance[offset + cell] = NAV_FIELD_INFINITY;
+			field.parent[offset + cell] = -1;
+			if (field.source[offset + cell] && field.cost[cell] != NAV_FIELD_BLOCKED)
+			{
+				field.distance[offset + cell] = 0.0;
+				queue.push(NavigationFieldEntry(0.0, cell));
+			}
+		}
+		relaxNavigationField(field, exit, queue, updated);
+		field.dirty_cells[exit].clear();
+	}
+	field.base_distance = field.distance;
+
+	for (size_t i = 0; i < field.changed_cells.size(); i++)
+	{
+		field.changed[field.changed_cells[i]] = 0;
+		field.increased[field.changed_cells[i]] = 0;
+	}
+	field.changed_cells.clear();
+}
+
+/** updateNavigationField
+ * Updates the distances of all exits after the costs of some cells changed. For each exit the shortest path trees below
+ * cells whose cost increased are invalidated and solved again from their valid neighbours, and cells whose cost decreased
+ * are propagated from. Only these regions of the grid are visited.
+ * @param field the navigation field
+ * @return the number of cells (over all exits) whose distance changed, their neighbourhoods are listed in dirty_cells
+ */
+inline unsigned int updateNavigationField(NavigationField& field)
+{
+	int cells = field.width * field.height;
+	unsigned int updated_count = 0;
+
+	for (int exit = 0; exit < field.exits; exit++)
+		field.dirty_cells[exit].clear();
+	if (field.changed_cells.empty())
+		return 0;
+
+	// cells whose steps changed: the changed cells and, for blocking changes, their neighbours (diagonal steps past them)
+	std::vector<int> seeds;
+	std::vector<int> invalid_roots;
+	std::vector<unsigned char> mark(cells, 0);
+	for (size_t i = 0; i < field.changed_cells.size(); i++)
+	{
+		int cell = field.changed_cells[i];
+		int cx = cell % field.width;
+		int cy = cell / field.width;
+		for (int y = cy - 1; y <= cy + 1; y++)
+		{
+			for (int x = cx - 1; x <= cx + 1; x++)
+			{
+				if (x < 0 || y < 0 || x >= field.width || y >= field.height)
+					continue;
+				int next = x + y * field.width;
+				if (next != cell && !field.increased[cell])
+					continue;
+				if (!mark[next])
+				{
+					mark[next] = 1;
+					seeds.push_back(next);
+					if (field.increased[cell])
+						invalid_roots.push_back(next);
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < seeds.size(); i++)
+		mark[seeds[i]] = 0;
+
+	std::vector<int> updated;
+	std::vector<int> invalid;
+	std::vector<double> old_distance;
+	for (int exit = 0; exit < field.exits; exit++)
+	{
+		int offset = exit * cells;
+		NavigationFieldQueue queue;
+		updated.clear();
+		invalid.clear();
+		old_distance.clear();
+
+		// invalidate the shortest path trees below the cells with more expensive steps (the children of a cell are the neighbours whose parent it is)
+		// (open exit cells keep their distance of 0, only their children are invalidated)
+		for (size_t i = 0; i < invalid_roots.size(); i++)
+		{
+			int root = invalid_roots[i];
+			if (field.distance[offset + root] >= NAV_FIELD_INFINITY || mark[root])
+				continue;
+			if (!field.source[offset + root] || field.cost[root] == NAV_FIELD_BLOCKED)
+			{
+				mark[root] = 1;
+				invalid.push_back(root);
+			}
+			else
+				addNavigationFieldChildren(field, offset, root, mark, invalid);
+		}
+		for (size_t i = 0; i < invalid.size(); i++)
+			addNavigationFieldChildren(field, offset, invalid[i], mark, invalid);
+		for (size_t i = 0; i < invalid.size(); i++)
+		{
+			old_distance.push_back(field.distance[offset + invalid[i]]);
+			field.distance[offset + invalid[i]] = NAV_FIELD_INFINITY;
+			field.parent[offset + invalid[i]] = -1;
+		}
+
+		// exits which were blocked and are now open are sources again
+		for (size_t i = 0; i < seeds.size(); i++)
+		{
+			int cell = seeds[i];
+			if (field.source[offset + cell] && field.cost[cell] != NAV_FIELD_BLOCKED && field.distance[offset + cell] > 0.0)
+			{
+				field.distance[offset + cell] = 0.0;
+				field.parent[offset + cell] = -1;
+				updated.push_back(cell);
+			}
+		}
+
+		// the invalidated cells and the cells with cheaper steps take their best distance from their neighbours and are propagated from
+		std::vector<int> candidates(invalid);
+		candidates.insert(candidates.end(), seeds.begin(), seeds.end());
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			int cell = candidates[i];
+			if (!field.walkable[offset + cell] || field.cost[cell] == NAV_FIELD_BLOCKED)
+				continue;
+			int cx = cell % field.width;
+			int cy = cell / field.width;
+			for (int y = cy - 1; y <= cy + 1; y++)
+			{
+				for (int x = cx - 1; x <= cx + 1; x++)
+				{
+					if (x < 0 || y < 0 || x >= field.width || y >= field.height || (x == cx && y == cy))
+						continue;
+					int from = x + y * field.width;
+					if (field.distance[offset + from] >= NAV_FIELD_INFINITY)
+						continue;
+					double step = navigationFieldStep(field, offset, from, cell);
+					if (step < 0.0)
+						continue;
+					if (field.distance[offset + from] + step < field.distance[offset + cell] - NAV_FIELD_TOLERANCE)
+					{
+						field.distance[offset + cell] = field.distance[offset + from] + step;
+						field.parent[offset + cell] = from;
+						updated.push_back(cell);
+					}
+				}
+			}
+			if (field.distance[offset + cell] < NAV_FIELD_INFINITY)
+				queue.push(NavigationFieldEntry(field.distance[offset + cell], cell));
+		}
+		relaxNavigationField(field, exit, queue, updated);
+
+		// invalidated cells (still marked) only count as updated if they were not reached again or were reached at another distance
+		size_t kept = 0;
+		for (size_t i = 0; i < updated.size(); i++)
+		{
+			if (!mark[updated[i]])
+				updated[kept++] = updated[i];
+		}
+		updated.resize(kept);
+		for (size_t i = 0; i < invalid.size(); i++)
+		{
+			mark[invalid[i]] = 0;
+			if (fabs(field.distance[offset + invalid[i]] - old_distance[i]) > NAV_FIELD_TOLERANCE)
+				updated.push_back(invalid[i]);
+		}
+
+		markNavigationFieldDirty(field, exit, updated, mark);
+		updated_count += (unsigned int)updated.size();
+	}
+
+	for (size_t i = 0; i < field.changed_cells.size(); i++)
+	{
+		field.changed[field.changed_cells[i]] = 0;
+		field.increased[field.changed_cells[i]] = 0;
+	}
+	field.changed_cells.clear();
+
+	return updated_count;
+}
+
+/** getNavigationFieldDirection
+ * Gets the direction towards an exit at a cell, down the gradient of the distance field
+ * @param field the navigation field
+ * @param exit exit index (starting at 0)
+ * @param cell cell index (x + y*width)
+ * @param direction_x returns the normalised x direction, 0 if the exit can not be reached from the cell
+ * @param direction_y returns the normalised y direction, 0 if the exit can not be reached from the cell
+ * @return 0 if the distances around the cell are the base distances, so the built exit vector should be kept
+ */
+inline int getNavigationFieldDirection(const NavigationField& field, int exit, int cell, float* direction_x, float* direction_y)
+{
+	int offset = exit * field.width * field.height;
+	*direction_x = 0.0f;
+	*direction_y = 0.0f;
+
+	if (!field.walkable[offset + cell])
+		return 0;
+
+	double distance = field.distance[offset + cell];
+	int cx = cell % field.width;
+	int cy = cell / field.width;
+
+	// keep the built vector where nothing changed around the cell
+	int unchanged = fabs(distance - field.base_distance[offset + cell]) <= NAV_FIELD_TOLERANCE ||
+		(distance >= NAV_FIELD_INFINITY && field.base_distance[offset + cell] >= NAV_FIELD_INFINITY);
+	for (int y = cy - 1; y <= cy + 1 && unchanged; y++)
+	{
+		for (int x = cx - 1; x <= cx + 1; x++)
+		{
+			if (x < 0 || y < 0 || x >= field.width || y >= field.height)
+				continue;
+			int next = offset + x + y * field.width;
+			if (fabs(field.distance[next] - field.base_distance[next]) > NAV_FIELD_TOLERANCE)
+			{
+				unchanged = 0;
+				break;
+			}
+		}
+	}
+	if (unchanged || field.source[offset + cell])
+		return 0;
+	if (distance >= NAV_FIELD_INFINITY)
+		return 1;
+
+	// each reachable neighbour closer to the exit pulls by the distance gained per unit length
+	double gx = 0.0, gy = 0.0;
+	for (int y = cy - 1; y <= cy + 1; y++)
+	{
+		for (int x = cx - 1; x <= cx + 1; x++)
+		{
+			if (x < 0 || y < 0 || x >= field.width || y >= field.height || (x == cx && y == cy))
+				continue;
+			int next = x + y * field.width;
+			if (navigationFieldStep(field, offset, cell, next) < 0.0 || field.distance[offset + next] >= distance)
+				continue;
+			double length_squared = (double)((x - cx) * (x - cx) + (y - cy) * (y - cy));
+			double gain = (distance - field.distance[offset + next]) / length_squared;
+			gx += (x - cx) * gain;
+			gy += (y - cy) * gain;
+		}
+	}
+	double length = sqrt(gx * gx + gy * gy);
+	if (length > 0.0)
+	{
+		*direction_x = (float)(gx / length);
+		*direction_y = (float)(gy / length);
+	}
+	return 1;
+}
+
+#endif //_NAVIGATION_FIELD
@@ -20,6 +20,8 @@
 #include "header.h"
 #include "CustomVisualisation.h"
 #include "cutil_math.h"
+#include "NavigationField.h"
+#include "FrameRenderer.h"
 
  // This is to output the computational time for each message function within each iteration (added by MS22May2018) 
  //#define INSTRUMENT_ITERATIONS 1
@@ -65,9 +67,46 @@
 #define ON			1
 #define OFF			0
 
+// Number of exits in the domain, must match the arrayLength of the EXIT environment constant arrays in XMLModelFile.xml
+#define NUM_EXITS	10
+
+// Elements of the envelope array of flood agents (see flood_envelope_on), the arrival time is 0 until the agent is first wet
+#define ENVELOPE_MAX_H			0
+#define ENVELOPE_MAX_VELOCITY	1
+#define ENVELOPE_MAX_HR			2
+#define ENVELOPE_ARRIVAL_TIME	3
+
 #define PI 3.1415f
 #define RADIANS(x) (PI / 180.0f) * x
 
+// Time series logs opened once in initConstants and written by DELTA_T_func in each iteration
+int output_series;
+int output_exits_series;
+
+// Metrics of the flood and pedestrians created in initConstants and set by DELTA_T_func (written with --metrics)
+int metric_sim_time;
+int metric_dt;
+int metric_max_depth;
+int metric_pedestrians;
+int metric_evacuated;
+int metric_unstable;
+int metric_hazard[HR_over_2p5 + 1];
+
+// Simulated times at which the full flood grid and pedestrian data are outputted (see initConstants)
+int profile_output_schedule;
+
+// Image frames of the flood and pedestrians written every frame_output_interval seconds of simulated time (see outputFrame)
+int frame_output_schedule;
+unsigned int frame_count;
+FrameImage frame_image;
+
+// State of the exit condition simulationFinished over iterations, reset by initConstants
+int exit_condition_steady_count;	// consecutive iterations with the change of water depth below exit_condition_dh_tolerance
+int exit_condition_pedestrians_seen;	// whether there have been pedestrians in the domain, so that an empty domain counts as evacuated once they have left
+
+// Flood time covered by the sub-steps of the current iteration when flood_subcycling_on is ON (see floodSubcycle)
+double flood_subcycle_time = 0.0;
+
 __FLAME_GPU_INIT_FUNC__ void initConstants()
 {
 	// This function assign initial values to DXL, DYL, and dt
@@ -88,9 +127,9 @@ __FLAME_GPU_INIT_FUNC__ void initConstants()
 
 
 	// the size of the computaional cell (flood agents)
-	// sqrt(xmachine_memory_FloodCell_MAX) is the number of agents in each direction. 
-	double dxl = (x_max - x_min) / sqrt(xmachine_memory_FloodCell_MAX);
-	double dyl = (y_max - y_min) / sqrt(xmachine_memory_FloodCell_MAX);
+	// the population width and height of the discrete flood agents are the number of agents in each direction. 
+	double dxl = (x_max - x_min) / get_FloodCell_population_width();
+	double dyl = (y_max - y_min) / get_FloodCell_population_height();
 
 	////////// Adaptive time-step function to assign initial dt value based on CFL criteria //////////// no need to be uncommented if there is no initial discharge/depth of water
 	//// for each flood agent in the state default
@@ -117,6 +156,41 @@ __FLAME_GPU_INIT_FUNC__ void initConstants()
 	set_sim_time(&sim_init);
 	set_init_depth_boundary(&init_depth_boundary);
 
+	// with sub-cycling pedestrians are stepped with dt_ped from the first iteration, the flood starts with the dt of the 
+	// initial states file if it is smaller (the following sub-steps take the flood time-step, see floodSubcycle)
+	if (*get_flood_subcycling_on() == ON)
+	{
+		double dt_ped = *get_dt_ped();
+		if (dt_ped <= 0.0)
+		{
+			fprintf(stderr, "Error: dt_ped must be greater than 0 when flood_subcycling_on is ON\n");
+			exit(EXIT_FAILURE);
+		}
+		double dt_init = *get_dt();
+		if (dt_init <= 0.0 || dt_init > dt_ped)
+			dt_init = dt_ped;
+		set_dt(&dt_init);
+
+		float TIME_SCALER = dt_ped / 181.81818181;
+		set_TIME_SCALER(&TIME_SCALER);
+		flood_subcycle_time = 0.0;
+	}
+
+	// local time stepping starts a new cycle, see advanceLTSCycle
+	if (*get_lts_on() == ON)
+	{
+		// ProcessWetDryMessage smooths the levels with a single pass over the neighbours, which only keeps every agent at most one 
+		// level coarser than its neighbours when the levels are 0 to 2
+		int lts_max_level = *get_lts_max_level();
+		if (lts_max_level < 0 || lts_max_level > 2)
+		{
+			fprintf(stderr, "Error: lts_max_level must be between 0 and 2 when lts_on is ON\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	int lts_substep = 0;
+	set_lts_substep(&lts_substep);
+
 
 	// Assigning pedestrian model default values to steering force parameters
 	float STEER_WEIGHT = 0.10f;
@@ -125,7 +199,7 @@ __FLAME_GPU_INIT_FUNC__ void initConstants()
 	float GOAL_WEIGHT = 0.20f;
 	//float TIME_SCALER = 0.007f; // it is purposefully selected. Be very careful while changing it
 
-	int exit_state_on = 1; 
+	int exit_state_on[NUM_EXITS];
 
 	set_STEER_WEIGHT(&STEER_WEIGHT);
 	set_AVOID_WEIGHT(&AVOID_WEIGHT);
@@ -134,16 +208,11 @@ __FLAME_GPU_INIT_FUNC__ void initConstants()
 	//set_TIME_SCALER(&TIME_SCALER);
 
 	// enabling the exits in the domain
-	set_EXIT1_STATE(&exit_state_on);
-	set_EXIT2_STATE(&exit_state_on);
-	set_EXIT3_STATE(&exit_state_on);
-	set_EXIT4_STATE(&exit_state_on);
-	set_EXIT5_STATE(&exit_state_on);
-	set_EXIT6_STATE(&exit_state_on);
-	set_EXIT7_STATE(&exit_state_on);
-	set_EXIT8_STATE(&exit_state_on);
-	set_EXIT9_STATE(&exit_state_on);
-	set_EXIT10_STATE(&exit_state_on);
+	for (int i = 0; i < NUM_EXITS; i++)
+	{
+		exit_state_on[i] = 1;
+	}
+	set_EXIT_STATE(exit_state_on);
 
 
 	// loading the pre-defined dimension of sandbags in 0.xml file
@@ -168,6 +237,283 @@ __FLAME_GPU_INIT_FUNC__ void initConstants()
 	// update the global constant variable that shows the number of sandbags to fill one single navmap/flood agent
 	set_fill_cap(&fill_area);
 
+
+	// Creating the time series of flood and pedestrian information, columns are set in DELTA_T_func in the order they are added here
+	// NOTE: 'max_at_highest_risk' -> maximum number of trapped pedestrians, 'max_at_low_risk' -> maximum number of in lay water, 
+	//		 'max_at_medium_risk' -> maximum number of distrupted1,   'max_at_high_risk' -> maximum number of distrupted2
+	output_series = createTimeSeries("output.csv", TIME_SERIES_CSV);
+	addTimeSeriesColumn(output_series, "sim_time", TIME_SERIES_DOUBLE);
+	addTimeSeriesColumn(output_series, "evacuated", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "to_be_evacuated", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "in_evacuating_area", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "in_dry", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "HR_below_0.75", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "HR_0.75_1.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "HR_1.5_2.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "HR_over_2.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "max_HR", TIME_SERIES_DOUBLE);
+	addTimeSeriesColumn(output_series, "max_h", TIME_SERIES_DOUBLE);
+	addTimeSeriesColumn(output_series, "max_v", TIME_SERIES_DOUBLE);
+	addTimeSeriesColumn(output_series, "max_reached_HR", TIME_SERIES_DOUBLE);
+	addTimeSeriesColumn(output_series, "max_HR_over_2.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "max_HR_below_0.75", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "max_HR_0.75_1.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "max_HR_1.5_2.5", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "sliding", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "toppling", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "both", TIME_SERIES_INT);
+	addTimeSeriesColumn(output_series, "unstable", TIME_SERIES_INT);
+
+	// Creating the time series of the number of pedestrians heading to each exit
+	output_exits_series = createTimeSeries("output_exits.csv", TIME_SERIES_CSV);
+	addTimeSeriesColumn(output_exits_series, "sim_time", TIME_SERIES_DOUBLE);
+	for (int i = 0; i < NUM_EXITS; i++)
+	{
+		char column_name[16];
+		sprintf(column_name, "exit%d", i + 1);
+		addTimeSeriesColumn(output_exits_series, column_name, TIME_SERIES_INT);
+	}
+
+	// Creating the metrics set in DELTA_T_func, e.g. for monitoring long console runs
+	metric_sim_time = createMetric("flood_sim_time_seconds", "Simulated time", METRIC_GAUGE);
+	metric_dt = createMetric("flood_dt_seconds", "Time-step of the last iteration", METRIC_GAUGE);
+	metric_max_depth = createMetric("flood_max_depth_meters", "Maximum water depth of the flood agents", METRIC_GAUGE);
+	metric_pedestrians = createMetric("pedestrians_in_domain", "Pedestrians in the domain (count_population)", METRIC_GAUGE);
+	metric_evacuated = createMetric("pedestrians_evacuated", "Pedestrians evacuated so far (evacuated_population)", METRIC_GAUGE);
+	metric_unstable = createMetric("pedestrians_unstable", "Pedestrians unstable due to sliding, toppling or both", METRIC_GAUGE);
+	for (int i = HR_zero; i <= HR_over_2p5; i++)
+	{
+		char metric_name[64];
+		sprintf(metric_name, "pedestrians_hazard{HR_state=\"%d\"}", i);
+		metric_hazard[i] = createMetric(metric_name, "Pedestrians in each hazard rating class of the water (HR_state)", METRIC_GAUGE);
+	}
+
+
+	///////////////////////////////////// OUTPUTTING FOR PROFILES ///////////////////////////////////////////////////
+	// Scheduling the outputs of flood and pedestrian profiles, each scheduled time is outputted once when the simulation time reaches it
+	// using outputting time for some cases, otherwise the results will be outputted at the end of flooding events
+	double outputting_time = *get_outputting_time();
+	if (outputting_time == 0.0f)
+	{
+		outputting_time = *get_inflow_end_time();
+	}
+
+	// loading outputting time intervals (defined by the user in input file (map.xml) )
+	double outputting_time_interval = *get_outputting_time_interval();
+
+	// outputting the results in different phases of the hydrograph
+	double start_time = *get_inflow_start_time();
+	double peak_time  = *get_inflow_peak_time();
+	double end_time   = *get_inflow_end_time();
+
+	double hydrograph_phases[] = {
+		start_time,
+		start_time + 0.5f*(peak_time - start_time),
+		peak_time,
+		peak_time + 0.5f*(end_time - peak_time),
+		end_time,
+		outputting_time };
+
+	profile_output_schedule = createOutputSchedule();
+	for (size_t i = 0; i < sizeof(hydrograph_phases) / sizeof(double); i++)
+	{
+		if (hydrograph_phases[i] <= outputting_time)
+			addOutputScheduleTime(profile_output_schedule, hydrograph_phases[i]);
+	}
+
+	// outputting based on the temporal time interval defined by the user
+	if (outputting_time_interval > 0.0f)
+		addOutputScheduleInterval(profile_output_schedule, 0.0, outputting_time_interval, outputting_time);
+
+	// image frames are numbered from 0 in each run
+	frame_output_schedule = createOutputSchedule();
+	frame_count = 0;
+	if (*get_frame_output_interval() > 0.0)
+	{
+		if (*get_frame_scale() < 1)
+		{
+			fprintf(stderr, "Error: frame_scale must be at least 1 when frame_output_interval is set\n");
+			exit(EXIT_FAILURE);
+		}
+		addOutputScheduleInterval(frame_output_schedule, 0.0, *get_frame_output_interval(), DBL_MAX);
+	}
+
+	exit_condition_steady_count = 0;
+	exit_condition_pedestrians_seen = 0;
+
+	// host state carried over iterations, saved in checkpoints and restored over the values above when a checkpoint is loaded
+	registerCheckpointHostState("flood_subcycle_time", &flood_subcycle_time, sizeof(flood_subcycle_time));
+	registerCheckpointHostState("exit_condition_steady_count", &exit_condition_steady_count, sizeof(exit_condition_steady_count));
+	registerCheckpointHostState("exit_condition_pedestrians_seen", &exit_condition_pedestrians_seen, sizeof(exit_condition_pedestrians_seen));
+	registerCheckpointHostState("frame_count", &frame_count, sizeof(frame_count));
+}
+
+// advancing the sub-step of the local time stepping cycle after each pass of the flood layers (1 to 4) when lts_on is ON. 
+// Over a cycle of 2^lts_max_level sub-steps of the same dt, each flood agent is updated every 2^lts_level sub-steps (see LTS_Level), 
+// all of them at the last one. Returns whether a cycle has been completed, only then can the flood time-step change.
+int advanceLTSCycle()
+{
+	if (*get_lts_on() == OFF)
+		return 1;
+
+	int lts_substep = (*get_lts_substep() + 1) % (1 << *get_lts_max_level());
+	set_lts_substep(&lts_substep);
+
+	return lts_substep == 0;
+}
+
+// repeating the flood layers (1 to 4, see subcycles in XMLModelFile.xml) when flood_subcycling_on is ON, so that the water is 
+// advanced with the flood time-step (as in DELTA_T_func) until it reaches dt_ped and pedestrians are then stepped once with dt_ped.
+// The simulation time is advanced by each sub-step, so that the inflow hydrograph follows the water.
+__FLAME_GPU_SUBCYCLE_FUNC__ int floodSubcycle()
+{
+	int lts_cycle_end = advanceLTSCycle();
+
+	if (*get_flood_subcycling_on() == OFF)
+		return CONTINUE;
+
+	double dt = *get_dt();
+	double dt_ped = *get_dt_ped();
+
+	double sim_time = *get_sim_time() + dt;
+	set_sim_time(&sim_time);
+	flood_subcycle_time += dt;
+
+	// the flood has reached the pedestrian step (up to round off), the next iteration starts with the dt set by DELTA_T_func
+	double remaining = dt_ped - flood_subcycle_time;
+	// with local time stepping dt is kept for the cycle, the last sub-step can pass dt_ped and the next pedestrian step accounts for it
+	int lts_on = *get_lts_on();
+	if (remaining <= 1.0e-9 * dt_ped)
+	{
+		flood_subcycle_time = (lts_on == ON) ? -remaining : 0.0;
+		return CONTINUE;
+	}
+
+	if (!lts_cycle_end)
+		return REPEAT;
+
+	double new_dt = remaining;
+	if (get_flood_max_h_reduction() > epsilon)
+	{
+		new_dt = *get_dt_flood();
+		if (*get_auto_dt_on() == ON)
+			new_dt = get_flood_min_timeStep_reduction();
+
+		// the last sub-step ends exactly at dt_ped
+		new_dt = fmin(new_dt, (lts_on == ON) ? dt_ped : remaining);
+	}
+
+	if (new_dt <= 0.0)
+	{
+		fprintf(stderr, "Error: the flood time-step is not positive in floodSubcycle (set dt_flood or auto_dt_on)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	set_dt(&new_dt);
+	return REPEAT;
+}
+
+// Writes an image of the flood and pedestrians to frame_<number>.png (or .ppm, see frame_format) in the output directory, from the 
+// host copies of the agent variables. Wet flood cells are coloured by water depth (up to frame_max_depth) or by hazard rating class
+// (frame_field), dry cells are shaded by bed level, and pedestrians are coloured by stability_state as in the visualisation 
+// (black when stable to red). Each flood cell is frame_scale pixels wide, north is at the top of the image.
+void outputFrame()
+{
+	// light to dark blue with the depth of water
+	static const unsigned char depth_map[][3] = { { 198, 219, 239 }, { 107, 174, 214 }, { 33, 113, 181 }, { 8, 48, 107 } };
+	// colour of each hazard rating class, from HR_0p0001_0p75 to HR_over_2p5
+	static const unsigned char hazard_colours[][3] = { { 255, 237, 160 }, { 254, 178, 76 }, { 240, 59, 32 }, { 128, 0, 38 } };
+
+	int width = get_FloodCell_population_width();
+	int height = get_FloodCell_population_height();
+	int scale = *get_frame_scale();
+	int frame_field = *get_frame_field();
+	double frame_max_depth = *get_frame_max_depth();
+
+	initFrameImage(frame_image, width * scale, height * scale);
+
+	int no_FloodCells = get_agent_FloodCell_Default_count();
+
+	// range of bed levels for shading the dry cells
+	double z0_min = DBL_MAX;
+	double z0_max = -DBL_MAX;
+	for (int index = 0; index < no_FloodCells; index++)
+	{
+		double z0 = get_FloodCell_Default_variable_z0(index);
+		z0_min = fmin(z0_min, z0);
+		z0_max = fmax(z0_max, z0);
+	}
+	double z0_range = (z0_max > z0_min) ? (z0_max - z0_min) : 1.0;
+
+	for (int index = 0; index < no_FloodCells; index++)
+	{
+		int x = get_FloodCell_Default_variable_x(index);
+		int y = get_FloodCell_Default_variable_y(index);
+		double flow_h = get_FloodCell_Default_variable_h(index);
+
+		unsigned char colour[3];
+		unsigned char grey = (unsigned char)(90.0 + 130.0 * (get_FloodCell_Default_variable_z0(index) - z0_min) / z0_range);
+		colour[0] = colour[1] = colour[2] = grey;
+
+		if (flow_h > epsilon)
+		{
+			if (frame_field == 0)
+			{
+				frameColourRamp(depth_map, 4, flow_h / frame_max_depth, colour);
+			}
+			else
+			{
+				// hazard rating of the cell as in the profile outputs of DELTA_T_func
+				double flow_velocity_x = get_FloodCell_Default_variable_qx(index) / flow_h;
+				double flow_velocity_y = get_FloodCell_Default_variable_qy(index) / flow_h;
+				double hazard_rate = fabs(flow_h * (max(flow_velocity_x, flow_velocity_y) + 0.5));
+
+				int HR_state = HR_zero;
+				if (hazard_rate > 2.5)
+					HR_state = HR_over_2p5;
+				else if (hazard_rate > 1.5)
+					HR_state = HR_1p5_2p5;
+				else if (hazard_rate > 0.75)
+					HR_state = HR_0p75_1p5;
+				else if (hazard_rate > epsilon)
+					HR_state = HR_0p0001_0p75;
+
+				if (HR_state != HR_zero)
+				{
+					colour[0] = hazard_colours[HR_state - 1][0];
+					colour[1] = hazard_colours[HR_state - 1][1];
+					colour[2] = hazard_colours[HR_state - 1][2];
+				}
+			}
+		}
+
+		fillFrameRect(frame_image, x * scale, (height - 1 - y) * scale, (x + 1) * scale, (height - y) * scale, colour);
+	}
+
+	// pedestrians are in the environment coordinates (-ENV_MAX to ENV_MAX) of the visualisation, which covers the flood grid
+	int no_pedestrians = get_agent_agent_default_count();
+	float radius = fmaxf(0.5f * scale, 1.0f);
+	for (int index = 0; index < no_pedestrians; index++)
+	{
+		float x = get_agent_default_variable_x(index);
+		float y = get_agent_default_variable_y(index);
+		float state = fminf(get_agent_default_variable_stability_state(index) / 3.0f, 1.0f);
+
+		unsigned char colour[3] = { (unsigned char)(255.0f * state), 0, 0 };
+		float px = (x + ENV_MAX) / ENV_WIDTH * frame_image.width;
+		float py = (1.0f - (y + ENV_MAX) / ENV_WIDTH) * frame_image.height;
+		fillFrameDisc(frame_image, px, py, radius, colour);
+	}
+
+	int frame_format = *get_frame_format();
+	char filename[32];
+	snprintf(filename, sizeof(filename), "frame_%06u.%s", frame_count, (frame_format == FRAME_FORMAT_PNG) ? "png" : "ppm");
+	std::string outputFilename = std::string(std::string(getOutputDir()) + filename);
+
+	if (!writeFrame(frame_image, outputFilename.c_str(), frame_format))
+		fprintf(stderr, "Error: file %s could not be created for outputFrame\n", outputFilename.c_str());
+
+	frame_count++;
 }
 
 // assigning dt for the next iteration
@@ -182,6 +528,8 @@ __FLAME_GPU_STEP_FUNC__ void DELTA_T_func()
 	//				  work on adaptive time stepping by taking the minimum calculated time-step of all the flood agents in the model
 	//			
 	//	2- Calculates the simulation time from the start of the simulation, with respect to the defined time-step (see 1)
+	//				* With flood_subcycling_on the flood is sub-cycled within the pedestrian step dt_ped (see floodSubcycle), 
+	//				  which advances the simulation time, and dt is only the first flood sub-step of the next iteration
 	//			
 	//	3- Sets the number of hero pedestrians based on the pre-defined percentage in 0.xml file 'hero_percentage'
 	//			
@@ -237,11 +585,12 @@ __FLAME_GPU_STEP_FUNC__ void DELTA_T_func()
 
 	// to enable the adaptive time-step uncomment this line
 	// Defining the time_step of the simulation with contributation of CFL
-	double minTimeStep = min_FloodCell_Default_timeStep_variable(); // for adaptive time stepping
+	// both are reduced by ProcessSpaceOperatorMessage as it updates the flood agents (see gpu:reductions)
+	double minTimeStep = get_flood_min_timeStep_reduction(); // for adaptive time stepping
 																	//double minTimeStep = 0.005; // for static time-stepping and measuring computation time
 
 	//Take the maximum height of water in the domain
-	double flow_h_max = max_FloodCell_Default_h_variable();
+	double flow_h_max = get_flood_max_h_reduction();
 	
 	// loading the time scaler from the last iteration
 	//float TIME_SCALER_ped = *get_TIME_SCALER_INIT(); // commented MS27092019 16:06
@@ -269,12 +618,27 @@ __FLAME_GPU_STEP_FUNC__ void DELTA_T_func()
 	}
 	
 		
+	// with local time stepping the flood time-step is kept until the end of the cycle (see advanceLTSCycle)
+	if ((*get_lts_on() == ON) && (*get_lts_substep() != 0))
+	{
+		new_dt = old_dt;
+	}
+
+	// with sub-cycling pedestrians always take dt_ped, the flood step is limited to it
+	int flood_subcycling_on = *get_flood_subcycling_on();
+	double ped_dt = new_dt;
+	if (flood_subcycling_on == ON)
+	{
+		new_dt = fmin(new_dt, dt_ped);
+		ped_dt = dt_ped;
+	}
+
 	// Setting new time step to the simulation
 	set_dt(&new_dt);
 
 	// set time scaler of the pedestrian evolution
 	//float TIME_SCALER = new_dt / 181.81818181; // 181.81818181 is the ratio of dt/TIME_SCALER based on try and error trials for realistic time evolution considering the walking speed of pedestrians. 
-	float TIME_SCALER = new_dt / 181.81818181; // 181.81818181 is the ratio of dt/TIME_SCALER based on try and error trials for realistic time evolution considering the walking speed of pedestrians. 
+	float TIME_SCALER = ped_dt / 181.81818181; // 181.81818181 is the ratio of dt/TIME_SCALER based on try and error trials for realistic time evolution considering the walking speed of pedestrians. 
 	set_TIME_SCALER(&TIME_SCALER);
 
 
@@ -282,6 +646,10 @@ __FLAME_GPU_STEP_FUNC__ void DELTA_T_func()
 	//double new_sim_time = old_sim_time + minTimeStep; //commented to load from 0.xml
 	double new_sim_time = old_sim_time + old_dt;
 
+	// the flood sub-steps have already advanced the simulation time by dt_ped
+	if (flood_subcycling_on == ON)
+		new_sim_time = old_sim_time;
+
 	set_sim_time(&new_sim_time);
 
 	
@@ -296,207 +664,64 @@ __FLAME_GPU_STEP_FUNC__ void DELTA_T_func()
 	//store the population of hero pedestrians
 	set_hero_population(&hero_population);
 
-	// counter constants 
-	
-	int count_in_dry = 0;
-	int count_at_low_risk = 0;
-	int count_at_medium_risk = 0;
-	int count_at_high_risk = 0;
-	int count_at_highest_risk = 0;
-	int count_heros = 0;
-
-	
-	int count_due_sliding = 0; // instable pedestrians due to sliding
-	int count_due_toppling = 0; // instable pedestrians due to toppling
-	int count_instable_due_both = 0; // instable pedestrians due to both sliding and toppling
-
-	// to count the number of pedestrians choosing one specific exit
-	int count_exit_1 = 0 ; 
-	int count_exit_2 = 0;
-	int count_exit_3 = 0;
-	int count_exit_4 = 0;
-	int count_exit_5 = 0;
-	int count_exit_6 = 0;
-	int count_exit_7 = 0;
-	int count_exit_8 = 0;
-	int count_exit_9 = 0;
-	int count_exit_10 = 0;
-
-
-	// uncomment if counting the number of people in each range of body height MS071019
-	//int count_60_110, count_110_140, count_140_163, count_163_170, count_170_186, count_186_194, count_194_210;
-
-	// loop over the number of pedestrians
-	for (int index = 0 ; index < no_pedestrians; index++)
+	// counting the pedestrians in each state with device histograms, only the bin counts are copied from the device
+	unsigned int stability_histogram[4];
+	unsigned int HR_state_histogram[HR_over_2p5 + 1];
+	unsigned int hero_histogram[2];
+	unsigned int exit_histogram[NUM_EXITS + 1];
+
+	histogram_agent_default_stability_state_variable(stability_histogram, 4);
+	histogram_agent_default_HR_state_variable(HR_state_histogram, HR_over_2p5 + 1);
+	histogram_agent_default_hero_status_variable(hero_histogram, 2);
+	histogram_agent_default_exit_no_variable(exit_histogram, NUM_EXITS + 1);
+
+	int count_due_sliding		= stability_histogram[1]; // instable pedestrians due to sliding
+	int count_due_toppling		= stability_histogram[2]; // instable pedestrians due to toppling
+	int count_instable_due_both = stability_histogram[3]; // instable pedestrians due to both sliding and toppling
+
+	// counting the number of pedestrians with different states
+	int count_in_dry			= HR_state_histogram[HR_zero];
+	int count_at_low_risk		= HR_state_histogram[HR_0p0001_0p75];
+	int count_at_medium_risk	= HR_state_histogram[HR_0p75_1p5];
+	int count_at_high_risk		= HR_state_histogram[HR_1p5_2p5];
+	int count_at_highest_risk	= HR_state_histogram[HR_over_2p5];
+
+	// pedestrians instable due to both sliding and toppling are only counted in the highest risk state, their HR states are fetched
+	// from the device only when there are any
+	if (count_instable_due_both > 0)
 	{
-		int pedestrians_state = get_agent_default_variable_HR_state(index);
-		int pedestrians_stability_state = get_agent_default_variable_stability_state(index);
-
-		// counting the number of instable pedestrians
-		if (pedestrians_stability_state == 1)
-		{
-			count_due_sliding++;
-		}
-		if (pedestrians_stability_state == 2)
-		{
-			count_due_toppling++;
-		}
-		if (pedestrians_stability_state == 3)
-		{
-			count_instable_due_both++;
-		}
-
-		// uncomment if counting the number of people in each range of body height MS071019
-		//float body_height = get_agent_default_variable_body_height(index); 
-
-		//// counting the number of pedestrians with different height ranges
-		//if (body_height >= 0.60f && body_height < 1.10f)
-		//{
-		//	count_60_110++;
-		//}
-		//if (body_height >= 1.10f && body_height < 1.40f)
-		//{
-		//	count_110_140++;
-		//}
-		//if (body_height >= 1.40f && body_height < 1.63f)
-		//{
-		//	count_140_163++;
-		//}
-		//if (body_height >= 1.63f && body_height < 1.70f)
-		//{
-		//	count_163_170++;
-		//}
-		//if (body_height >= 1.70f && body_height < 1.86f)
-		//{
-		//	count_170_186++;
-		//}
-		//if (body_height >= 1.86f && body_height < 1.94f)
-		//{
-		//	count_186_194++;
-		//}
-		//if (body_height >= 1.94f && body_height < 2.10f)
-		//{
-		//	count_194_210++;
-		//}
-
-		// counting the number of pedestrians with different states
-		else if (pedestrians_state == HR_zero)
+		for (int index = 0; index < no_pedestrians; index++)
 		{
-			count_in_dry++;
+			if (get_agent_default_variable_stability_state(index) != 3)
+				continue;
+
+			int pedestrians_state = get_agent_default_variable_HR_state(index);
+			if (pedestrians_state == HR_zero)
+				count_in_dry--;
+			else if (pedestrians_state == HR_0p0001_0p75)
+				count_at_low_risk--;
+			else if (pedestrians_state == HR_0p75_1p5)
+				count_at_medium_risk--;
+			else if (pedestrians_state == HR_1p5_2p5)
+				count_at_high_risk--;
 		}
-		else if (pedestrians_state == HR_0p0001_0p75)
-		{
-			count_at_low_risk++;
-		}
-		else if (pedestrians_state == HR_0p75_1p5)
-		{
-			count_at_medium_risk++;
-		}
-		else if (pedestrians_state == HR_1p5_2p5)
-		{
-			count_at_high_risk++;
-		}
-		if (pedestrians_state == HR_over_2p5)
-		{
-			count_at_highest_risk++;
-		}
-
-		int pedestrian_hero_status = get_agent_default_variable_hero_status(index);
-		
-		if (pedestrian_hero_status == 1)
-		{
-			count_heros++;
-		}
-		
-		int ped_exit_no = get_agent_default_variable_exit_no(index);
-
-		if (ped_exit_no == 1)
-		{
-			count_exit_1++; 
-		}
-		else if (ped_exit_no == 2)
-		{
-			count_exit_2++;
-		}
-		else if (ped_exit_no == 3)
-		{
-			count_exit_3++;
-		}
-		else if (ped_exit_no == 4)
-		{
-			count_exit_4++;
-		}
-		else if (ped_exit_no == 5)
-		{
-			count_exit_5++;
-		}
-		else if (ped_exit_no == 6)
-		{
-			count_exit_6++;
-		}
-		else if (ped_exit_no == 7)
-		{
-			count_exit_7++;
-		}
-		else if (ped_exit_no == 8)
-		{
-			count_exit_8++;
-		}
-		else if (ped_exit_no == 9)
-		{
-			count_exit_9++;
-		}
-		else 
-		{
-			count_exit_10++;
-		}
-
-
 	}
 
-	int popular_exit; // = max(count_exit_1, count_exit_2, count_exit_3, count_exit_4, count_exit_5, count_exit_6, count_exit_7, count_exit_8, count_exit_9, count_exit_10);
-	
-	//finding the maximum number of people going toward a specific exit 
-	if (count_exit_1 >= count_exit_2 && count_exit_1 >= count_exit_3 && count_exit_1 >= count_exit_4 && count_exit_1 >= count_exit_5 && count_exit_1 >= count_exit_6 && count_exit_1 >= count_exit_7 && count_exit_1 >= count_exit_8 && count_exit_1 >= count_exit_9 && count_exit_1 >= count_exit_10)
-	{
-		popular_exit = 1;
-	}
-else if (count_exit_2 >= count_exit_1 && count_exit_2 >= count_exit_3 && count_exit_2 >= count_exit_4 && count_exit_2 >= count_exit_5 && count_exit_2 >= count_exit_6 && count_exit_2 >= count_exit_7 && count_exit_2 >= count_exit_8 && count_exit_2 >= count_exit_9 && count_exit_2 >= count_exit_10)
-	{
-		popular_exit = 2;
-	}
-else if (count_exit_3 >= count_exit_1 && count_exit_3 >= count_exit_2 && count_exit_3 >= count_exit_4 && count_exit_3 >= count_exit_5 && count_exit_3 >= count_exit_6 && count_exit_3 >= count_exit_7 && count_exit_3 >= count_exit_8 && count_exit_3 >= count_exit_9 && count_exit_3 >= count_exit_10)
-	{
-		popular_exit = 3;
-	}
-else if (count_exit_4 >= count_exit_1 && count_exit_4 >= count_exit_2 && count_exit_4 >= count_exit_5 && count_exit_4 >= count_exit_5 && count_exit_4 >= count_exit_6 && count_exit_4 >= count_exit_7 && count_exit_4 >= count_exit_8 && count_exit_4 >= count_exit_9 && count_exit_4 >= count_exit_10)
-	{
-		popular_exit = 4;
-	}
-else if (count_exit_5 >= count_exit_1 && count_exit_5 >= count_exit_2 && count_exit_5 >= count_exit_3 && count_exit_5 >= count_exit_4 && count_exit_5 >= count_exit_6 && count_exit_5 >= count_exit_7 && count_exit_5 >= count_exit_8 && count_exit_5 >= count_exit_9 && count_exit_5 >= count_exit_10)
-	{
-		popular_exit = 5;
-	}
-else if (count_exit_6 >= count_exit_1 && count_exit_6 >= count_exit_2 && count_exit_6 >= count_exit_3 && count_exit_6 >= count_exit_4 && count_exit_6 >= count_exit_5 && count_exit_6 >= count_exit_7 && count_exit_6 >= count_exit_8 && count_exit_6 >= count_exit_9 && count_exit_6 >= count_exit_10)
-	{
-		popular_exit = 6;
-	}
-else if (count_exit_7 >= count_exit_1 && count_exit_7 >= count_exit_2 && count_exit_7 >= count_exit_3 && count_exit_7 >= count_exit_4 && count_exit_7 >= count_exit_5 && count_exit_7 >= count_exit_6 && count_exit_7 >= count_exit_8 && count_exit_7 >= count_exit_9 && count_exit_7 >= count_exit_10)
-	{
-		popular_exit = 7;
-	}
-else if (count_exit_8 >= count_exit_1 && count_exit_8 >= count_exit_2 && count_exit_8 >= count_exit_3 && count_exit_8 >= count_exit_4 && count_exit_8 >= count_exit_5 && count_exit_8 >= count_exit_6 && count_exit_8 >= count_exit_7 && count_exit_8 >= count_exit_9 && count_exit_8 >= count_exit_10)
-	{
-		popular_exit = 8;
-	}
-else if (count_exit_9 >= count_exit_1 && count_exit_9 >= count_exit_2 && count_exit_9 >= count_exit_3 && count_exit_9 >= count_exit_4 && count_exit_9 >= count_exit_5 && count_exit_9 >= count_exit_6 && count_exit_9 >= count_exit_7 && count_exit_9 >= count_exit_8 && count_exit_9 >= count_exit_10)
-	{
-		popular_exit = 9;
-	}
-else
+	int count_heros = hero_histogram[1];
+
+	// to count the number of pedestrians choosing one specific exit (element i corresponds to exit number i+1)
+	// any exit number outside of the valid range is counted against the last exit
+	unsigned int count_exit[NUM_EXITS];
+	unsigned int count_valid_exit = 0;
+	for (int i = 0; i < NUM_EXITS; i++)
 	{
-		popular_exit = 10;
+		count_exit[i] = exit_histogram[i + 1];
+		count_valid_exit += count_exit[i];
 	}
+	count_exit[NUM_EXITS - 1] += no_pedestrians - count_valid_exit;
+
+	//finding the maximum number of people going toward a specific exit (the lowest exit number wins a tie)
+	int popular_exit = histogram_argmax(count_exit, NUM_EXITS) + 1;
 
 	printf("\n POPULAR EXIT AT THE MOMENT IS = %d\n", popular_exit);
 
@@ -717,7 +942,6 @@ else
 	set_emer_alarm(&emergency_alarm);
 
 	// To assign zero values to the constant variables governing the emission rate and the probablity of exits (DO NOT FORGET TO UNCOMMENT IF EVACUATION STRATEGY NEEDED)
-	float dont_emit = 0.0f;
 	int dont_exit = 0;
 	int do_exit = 10;
 
@@ -741,179 +965,24 @@ else
 			if (emergency_alarm > NO_ALARM) // greater than zero
 		{
 			// Stop emission of pedestian when emergency alarm is issued
-			set_EMMISION_RATE_EXIT1(&dont_emit);
-			set_EMMISION_RATE_EXIT2(&dont_emit);
-			set_EMMISION_RATE_EXIT3(&dont_emit);
-			set_EMMISION_RATE_EXIT4(&dont_emit);
-			set_EMMISION_RATE_EXIT5(&dont_emit);
-			set_EMMISION_RATE_EXIT6(&dont_emit);
-			set_EMMISION_RATE_EXIT7(&dont_emit);
-			set_EMMISION_RATE_EXIT8(&dont_emit);
-			set_EMMISION_RATE_EXIT9(&dont_emit);
-			set_EMMISION_RATE_EXIT10(&dont_emit);
-
+			float dont_emit[NUM_EXITS];
 			// it is ONLY effective when new pedestrians are produced during the flooding (in case less emission rate is used)
 			// Kept here in purpose to keep this capability
-			if (emergency_exit_number == 1)
-			{
-				set_EXIT1_PROBABILITY(&do_exit);
-
-				set_EXIT2_PROBABILITY(&dont_exit);
-				set_EXIT3_PROBABILITY(&dont_exit);
-				set_EXIT4_PROBABILITY(&dont_exit);
-				set_EXIT5_PROBABILITY(&dont_exit);
-				set_EXIT6_PROBABILITY(&dont_exit);
-				set_EXIT7_PROBABILITY(&dont_exit);
-				set_EXIT8_PROBABILITY(&dont_exit);
-				set_EXIT9_PROBABILITY(&dont_exit);
-				set_EXIT10_PROBABILITY(&dont_exit);
+			int exit_probability[NUM_EXITS];
 
+			for (int i = 0; i < NUM_EXITS; i++)
+			{
+				dont_emit[i] = 0.0f;
+				exit_probability[i] = (i + 1 == emergency_exit_number) ? do_exit : dont_exit;
 			}
-			else
-				if (emergency_exit_number == 2)
-				{
-					set_EXIT2_PROBABILITY(&do_exit);
-
-					set_EXIT1_PROBABILITY(&dont_exit);
-					set_EXIT3_PROBABILITY(&dont_exit);
-					set_EXIT4_PROBABILITY(&dont_exit);
-					set_EXIT5_PROBABILITY(&dont_exit);
-					set_EXIT6_PROBABILITY(&dont_exit);
-					set_EXIT7_PROBABILITY(&dont_exit);
-					set_EXIT8_PROBABILITY(&dont_exit);
-					set_EXIT9_PROBABILITY(&dont_exit);
-					set_EXIT10_PROBABILITY(&dont_exit);
-
-				}
-				else
-					if (emergency_exit_number == 3)
-					{
-						set_EXIT3_PROBABILITY(&do_exit);
-
-						set_EXIT1_PROBABILITY(&dont_exit);
-						set_EXIT2_PROBABILITY(&dont_exit);
-						set_EXIT4_PROBABILITY(&dont_exit);
-						set_EXIT5_PROBABILITY(&dont_exit);
-						set_EXIT6_PROBABILITY(&dont_exit);
-						set_EXIT7_PROBABILITY(&dont_exit);
-						set_EXIT8_PROBABILITY(&dont_exit);
-						set_EXIT9_PROBABILITY(&dont_exit);
-						set_EXIT10_PROBABILITY(&dont_exit);
-
-					}
-					else
-						if (emergency_exit_number == 4)
-						{
-							set_EXIT4_PROBABILITY(&do_exit);
-
-							set_EXIT1_PROBABILITY(&dont_exit);
-							set_EXIT2_PROBABILITY(&dont_exit);
-							set_EXIT3_PROBABILITY(&dont_exit);
-							set_EXIT5_PROBABILITY(&dont_exit);
-							set_EXIT6_PROBABILITY(&dont_exit);
-							set_EXIT7_PROBABILITY(&dont_exit);
-							set_EXIT8_PROBABILITY(&dont_exit);
-							set_EXIT9_PROBABILITY(&dont_exit);
-							set_EXIT10_PROBABILITY(&dont_exit);
-
-						}
-						else
-							if (emergency_exit_number == 5)
-							{
-								set_EXIT5_PROBABILITY(&do_exit);
-
-								set_EXIT1_PROBABILITY(&dont_exit);
-								set_EXIT2_PROBABILITY(&dont_exit);
-								set_EXIT3_PROBABILITY(&dont_exit);
-								set_EXIT4_PROBABILITY(&dont_exit);
-								set_EXIT6_PROBABILITY(&dont_exit);
-								set_EXIT7_PROBABILITY(&dont_exit);
-								set_EXIT8_PROBABILITY(&dont_exit);
-								set_EXIT9_PROBABILITY(&dont_exit);
-								set_EXIT10_PROBABILITY(&dont_exit);
-
-							}
-							else
-								if (emergency_exit_number == 6)
-								{
-									set_EXIT6_PROBABILITY(&do_exit);
-
-									set_EXIT1_PROBABILITY(&dont_exit);
-									set_EXIT2_PROBABILITY(&dont_exit);
-									set_EXIT3_PROBABILITY(&dont_exit);
-									set_EXIT4_PROBABILITY(&dont_exit);
-									set_EXIT5_PROBABILITY(&dont_exit);
-									set_EXIT7_PROBABILITY(&dont_exit);
-									set_EXIT8_PROBABILITY(&dont_exit);
-									set_EXIT9_PROBABILITY(&dont_exit);
-									set_EXIT10_PROBABILITY(&dont_exit);
 
-								}
-								else
-									if (emergency_exit_number == 7)
-									{
-										set_EXIT7_PROBABILITY(&do_exit);
-
-										set_EXIT1_PROBABILITY(&dont_exit);
-										set_EXIT2_PROBABILITY(&dont_exit);
-										set_EXIT3_PROBABILITY(&dont_exit);
-										set_EXIT4_PROBABILITY(&dont_exit);
-										set_EXIT5_PROBABILITY(&dont_exit);
-										set_EXIT6_PROBABILITY(&dont_exit);
-										set_EXIT8_PROBABILITY(&dont_exit);
-										set_EXIT9_PROBABILITY(&dont_exit);
-										set_EXIT10_PROBABILITY(&dont_exit);
-
-									}
-									else
-										if (emergency_exit_number == 8)
-										{
-											set_EXIT8_PROBABILITY(&do_exit);
-
-											set_EXIT1_PROBABILITY(&dont_exit);
-											set_EXIT2_PROBABILITY(&dont_exit);
-											set_EXIT3_PROBABILITY(&dont_exit);
-											set_EXIT4_PROBABILITY(&dont_exit);
-											set_EXIT5_PROBABILITY(&dont_exit);
-											set_EXIT6_PROBABILITY(&dont_exit);
-											set_EXIT7_PROBABILITY(&dont_exit);
-											set_EXIT9_PROBABILITY(&dont_exit);
-											set_EXIT10_PROBABILITY(&dont_exit);
-
-										}
-										else
-											if (emergency_exit_number == 9)
-											{
-												set_EXIT9_PROBABILITY(&do_exit);
-
-												set_EXIT1_PROBABILITY(&dont_exit);
-												set_EXIT2_PROBABILITY(&dont_exit);
-												set_EXIT3_PROBABILITY(&dont_exit);
-												set_EXIT4_PROBABILITY(&dont_exit);
-												set_EXIT5_PROBABILITY(&dont_exit);
-												set_EXIT6_PROBABILITY(&dont_exit);
-												set_EXIT7_PROBABILITY(&dont_exit);
-												set_EXIT8_PROBABILITY(&dont_exit);
-												set_EXIT10_PROBABILITY(&dont_exit);
-
-											}
-											else
-												if (emergency_exit_number == 10)
-												{
-													set_EXIT10_PROBABILITY(&do_exit);
-
-													set_EXIT1_PROBABILITY(&dont_exit);
-													set_EXIT2_PROBABILITY(&dont_exit);
-													set_EXIT3_PROBABILITY(&dont_exit);
-													set_EXIT4_PROBABILITY(&dont_exit);
-													set_EXIT5_PROBABILITY(&dont_exit);
-													set_EXIT6_PROBABILITY(&dont_exit);
-													set_EXIT7_PROBABILITY(&dont_exit);
-													set_EXIT8_PROBABILITY(&dont_exit);
-													set_EXIT9_PROBABILITY(&dont_exit);
-
-												}
+			set_EMMISION_RATE_EXIT(dont_emit);
 
+			// only update the probabilities if the emergency exit is valid
+			if (emergency_exit_number >= 1 && emergency_exit_number <= NUM_EXITS)
+			{
+				set_EXIT_PROBABILITY(exit_probability);
+			}
 		}
 	}
 	
@@ -1016,16 +1085,12 @@ else
 	
 	///////////////////////////////////////////////GENERAL OUTPUT IN COMMAND WINDOWS , uncomment any required /////////////////////////////////////////////////////////////////
 
-	//printing the simulation time
-	float start_time	= *get_inflow_start_time();
-	float peak_time		= *get_inflow_peak_time();
-	float end_time		= *get_inflow_end_time();
-
 	int initial_population = *get_initial_population();
 
 
 	printf("\n\n\n**************************************************************************************\n");
 	printf("**************************************************************************************\n");
+	//printing the simulation time
 	printf("\nElapsed simulation time = %.3f seconds\tOR\t%.2f minutes\tOR\t%.2f Hours \n", new_sim_time, new_sim_time/60, new_sim_time/3600); //prints simulation time 
 	//printing the total number of pedestrians in each iteration
 	printf("\n****************************** Pedestrian information *******************************\n");
@@ -1052,16 +1117,16 @@ else
 	printf("\nTotal number of pedestrians at 'highest' risk (HR>2.5) = %d \n", count_at_highest_risk);
 
 
-	//printf("\nNumber of pedestrians going toward Exit 1 = %d \n", count_exit_1);
-	//printf("\nNumber of pedestrians going toward Exit 2 = %d \n", count_exit_2);
-	//printf("\nNumber of pedestrians going toward Exit 3 = %d \n", count_exit_3);
-	//printf("\nNumber of pedestrians going toward Exit 4 = %d \n", count_exit_4);
-	//printf("\nNumber of pedestrians going toward Exit 5 = %d \n", count_exit_5);
-	printf("\nNumber of pedestrians going toward Exit 6 = %d \n", count_exit_6);
-	printf("\nNumber of pedestrians going toward Exit 7 = %d \n", count_exit_7);
-	//printf("\nNumber of pedestrians going toward Exit 8 = %d \n", count_exit_8);
-	//printf("\nNumber of pedestrians going toward Exit 9 = %d \n", count_exit_9);
-	printf("\nNumber of pedestrians going toward Exit 10 = %d \n", count_exit_10);
+	//printf("\nNumber of pedestrians going toward Exit 1 = %u \n", count_exit[0]);
+	//printf("\nNumber of pedestrians going toward Exit 2 = %u \n", count_exit[1]);
+	//printf("\nNumber of pedestrians going toward Exit 3 = %u \n", count_exit[2]);
+	//printf("\nNumber of pedestrians going toward Exit 4 = %u \n", count_exit[3]);
+	//printf("\nNumber of pedestrians going toward Exit 5 = %u \n", count_exit[4]);
+	printf("\nNumber of pedestrians going toward Exit 6 = %u \n", count_exit[5]);
+	printf("\nNumber of pedestrians going toward Exit 7 = %u \n", count_exit[6]);
+	//printf("\nNumber of pedestrians going toward Exit 8 = %u \n", count_exit[7]);
+	//printf("\nNumber of pedestrians going toward Exit 9 = %u \n", count_exit[8]);
+	printf("\nNumber of pedestrians going toward Exit 10 = %u \n", count_exit[9]);
 
 	////printing the number of dead pedestrians got stuck into water in each iteration
 	/*printf("\nMaximum number of pedestrians at 'low' risk (0.001<HR<0.75) = %d \n", max_at_low_risk);
@@ -1117,97 +1182,67 @@ else
 
 	////printf("\n the number of put sandbag layers is =  %d \n", sandbag_layers);
 	///////////////////////////////////////// Printing the info of flood and pedestrian agents to a file ///////////////////////////////
-	// Outputting the information to an appendable file which is updated in each iteration by adding data to the end of document
-	// Make sure the 'output.txt' file created from the last simulation is removed from ./iterations
-	FILE * fp = fopen("iterations/output.txt", "a");
-	//
-	if (fp == NULL)
+	// Adding a row to the time series created in initConstants, rows are buffered and written to the output directory periodically
+	unsigned int column = 0;
+	setTimeSeriesDouble(output_series, column++, new_sim_time);
+	setTimeSeriesInt(output_series, column++, evacuated_population);
+	setTimeSeriesInt(output_series, column++, initial_population - evacuated_population);
+	setTimeSeriesInt(output_series, column++, no_pedestrians);
+	setTimeSeriesInt(output_series, column++, count_in_dry);
+	setTimeSeriesInt(output_series, column++, count_at_low_risk);
+	setTimeSeriesInt(output_series, column++, count_at_medium_risk);
+	setTimeSeriesInt(output_series, column++, count_at_high_risk);
+	setTimeSeriesInt(output_series, column++, count_at_highest_risk);
+	setTimeSeriesDouble(output_series, column++, HR);
+	setTimeSeriesDouble(output_series, column++, flow_h_max);
+	setTimeSeriesDouble(output_series, column++, flow_velocity_max);
+	setTimeSeriesDouble(output_series, column++, HR_max);
+	setTimeSeriesInt(output_series, column++, max_at_highest_risk);
+	setTimeSeriesInt(output_series, column++, max_at_low_risk);
+	setTimeSeriesInt(output_series, column++, max_at_medium_risk);
+	setTimeSeriesInt(output_series, column++, max_at_high_risk);
+	setTimeSeriesInt(output_series, column++, count_due_sliding);
+	setTimeSeriesInt(output_series, column++, count_due_toppling);
+	setTimeSeriesInt(output_series, column++, count_instable_due_both);
+	setTimeSeriesInt(output_series, column++, count_due_sliding + count_due_toppling + count_instable_due_both);
+	commitTimeSeriesRow(output_series);
+
+	setTimeSeriesDouble(output_exits_series, 0, new_sim_time);
+	for (int i = 0; i < NUM_EXITS; i++)
 	{
-		printf("Error opening file!\n");
-		exit(1);
+		setTimeSeriesInt(output_exits_series, i + 1, count_exit[i]);
 	}
-
-	FILE* fp00 = fopen("iterations/output_exits.txt", "a");
-	//
-	if (fp00 == NULL)
+	commitTimeSeriesRow(output_exits_series);
+
+	// Updating the metrics, written to the --metrics file periodically
+	setMetric(metric_sim_time, new_sim_time);
+	setMetric(metric_dt, new_dt);
+	setMetric(metric_max_depth, flow_h_max);
+	setMetric(metric_pedestrians, no_pedestrians);
+	setMetric(metric_evacuated, sum_evacuated);
+	setMetric(metric_unstable, count_due_sliding + count_due_toppling + count_instable_due_both);
+	for (int i = HR_zero; i <= HR_over_2p5; i++)
 	{
-		printf("Error opening file!\n");
-		exit(1);
+		setMetric(metric_hazard[i], HR_state_histogram[i]);
 	}
-
-	//fprintf(fp, "%.3f\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t\t%d\t\t%d\t\t%d\t\t\n", new_sim_time, no_pedestrians, count_in_dry, count_at_low_risk, count_alive_walk, count_at_high_risk,count_at_highest_risk,HR, flow_h_max, flow_velocity_max, HR_max, max_at_highest_risk, max_at_low_risk, max_at_medium_risk, max_at_high_risk);
-	
-	  
-	 // Output a header row for the output.txt file 
-	//fprintf(fp, "Sim.t\t\t      no.Evacuated\t\t         no.2b.Evacuated\t\t     no.inEvacuatingInArea\t\t\t     InDry\t\t    HR<0.75\t\t     0.75<HR<1.5\t\t    1.5<HR<2.5\t\t   HR>2.5\t\t MaxHR\t\t      MaxH\t\t         MaxV\t\t     MaxReachedHR\t\t\t  Max_HR>2.5\t\t    Max_HR<0.75\t\t     Max_0.75<HR<1.5\t\t    Max_1.5<HR<2.5\t\t   Sliding\t\t    Toppling\t\t     both\t\t    unstable\t\t   \n");
-	   
-	fprintf(fp, "%.3f\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t\n", 
-		new_sim_time, 
-		evacuated_population, initial_population - evacuated_population, no_pedestrians, 
-		count_in_dry, count_at_low_risk, count_at_medium_risk, count_at_high_risk, count_at_highest_risk, 
-		HR, flow_h_max, flow_velocity_max, HR_max, 
-		max_at_highest_risk, max_at_low_risk,max_at_medium_risk, max_at_high_risk, 
-		count_due_sliding, count_due_toppling, count_instable_due_both, count_due_sliding+count_due_toppling+count_instable_due_both);
-	// NOTE:  'max_at_highest_risk' -> maximum number of trapped pedestrians, 'max_at_low_risk' -> maximum number of in lay water, 
-	//		  'max_at_medium_risk' -> maximum number of distrupted1,   'max_at_high_risk' -> maximum number of distrupted2
-	
-	fclose(fp);
-
-	fprintf(fp00, "%f\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t%d\t\t\n",
-		new_sim_time,
-		count_exit_1, count_exit_2, count_exit_3, count_exit_4, count_exit_5, count_exit_6, count_exit_7, count_exit_8, count_exit_9 , count_exit_10); // one is reduced to ignore the first iteration increment
-	fclose(fp00);
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		
 	///////////////////////////////////// OUTPUTTING FOR PROFILES ///////////////////////////////////////////////////
 		//// for printing outputs in each iteration, it defines the name of each outputed file the same as simulation time e.g. 32.000.txt, which
 		////	includes the outputted data at simulation time = 32 sec
-	// Define when to output the data
-	
-	// using outputting time for some cases, otherwise the results will be outputted at the end of flooding events
-	double outputting_time_manual = *get_outputting_time();
-	
-	double outputting_time_auto = *get_inflow_end_time();
-
-	// loading outputting time intervals (defined by the user in input file (map.xml) )
-	double outputting_time_interval = *get_outputting_time_interval();
-
-	double outputting_time;
-
-	if (outputting_time_manual != 0.0f)
-	{
-		outputting_time = outputting_time_manual;
-	}
-	else
-	{
-		outputting_time = outputting_time_auto;
-	}
-
-	double mid_start_time = start_time + 0.5f*(peak_time - start_time);
-	double mid_peak_time  = peak_time  + 0.5f*(end_time  - peak_time );
-	
-	// rounding the simulation time for outputting purposes (see the second conditional statement below)
-	double round_new_sim_time = round(new_sim_time);
-
-	
-	// this is to later check if the output interval time is reached or not
-	double residual_time = fmod(round_new_sim_time, outputting_time_interval);
-
 	// Outputting static results for the profile of water and the location of people with differen states
-	if (round_new_sim_time <= outputting_time )
-	{
+	// only once when one or more of the output times scheduled in initConstants have been reached in this iteration
+	unsigned int profile_outputs = checkOutputSchedule(profile_output_schedule, new_sim_time);
+	int profile_output_format = *get_profile_output_format();
 
-	// outputting the results in multiple time intervals 
-		if (   (round_new_sim_time == start_time)
-			|| ( new_sim_time >= mid_start_time && new_sim_time < mid_start_time + old_dt)
-			|| (round_new_sim_time == peak_time)
-			|| (new_sim_time >= mid_peak_time && new_sim_time < mid_peak_time + old_dt)
-			|| (round_new_sim_time == end_time)
-			|| (round_new_sim_time == outputting_time)
-			// outputting based on the temporal time interval defined by the user
-			|| (residual_time == 0.000f) )
+	// all agents as VTK files (<sim_time>_<agent>_<state>.vti/.vtp) with a time series index per agent state, for ParaView. The flood
+	// and navmap images span the environment (-ENV_MAX to ENV_MAX) of the pedestrian points, as in the visualisation
+	if (profile_outputs > 0 && profile_output_format != 0)
+		saveVTKOutput(std::to_string(new_sim_time).c_str(), new_sim_time, -ENV_MAX, -ENV_MAX,
+			ENV_WIDTH / get_FloodCell_population_width(), ENV_WIDTH / get_FloodCell_population_height());
 
-			{
+	if (profile_outputs > 0 && profile_output_format != 1)
+	{
 
 			//// outputting the results for only one iteration after the end of output time / 
 			//if (new_sim_time >= outputting_time && new_sim_time < outputting_time + old_dt)
@@ -1263,79 +1298,385 @@ else
 							flow_velocity_y = 0;
 						}
 
-						double flow_velocity_xy = max(flow_velocity_x, flow_velocity_y);   // taking maximum discharge between both x and y direction
+						double flow_velocity_xy = max(flow_velocity_x, flow_velocity_y);   // taking maximum discharge between both x and y direction
+
+						// calculating local hazard rate
+						double hazard_rate = fabs(flow_h*(flow_velocity_xy + 0.5));
+
+						
+						// NOTE: for outputing the cross sectional profile of water in the centre line of x-axis, 
+						// uncomment the if condition statement
+						// Otherwise, outputs of the entire flood grid
+						//int middle_pos = sqrt(no_FloodCells) / 2;
+
+						//if (x == middle_pos)
+						//{
+							fprintf(fp2, "%.3f\t\t%.3f\t\t%f\t\t%f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\n", x*dxl, y*dyl, flow_h, flow_velocity_xy, hazard_rate, flow_velocity_x, flow_velocity_y, z0);
+						// }
+					}
+					/////////////////////////////////////////////////////////////////////////
+
+
+
+				//	//////////////////////////////// Outputting the location of pedestrians /////////////////////////////////////////
+					for (int index = 0; index < no_pedestrians; index++)
+					{
+						int HR_state = get_agent_default_variable_HR_state(index);
+						float x = get_agent_default_variable_x(index);
+						float y = get_agent_default_variable_y(index);
+						double xmax = *get_xmax();
+						double ymax = *get_ymax();
+
+						double HR_ped = get_agent_default_variable_HR(index);
+						
+						int stability_state = get_agent_default_variable_stability_state(index);
+						float d_water = get_agent_default_variable_d_water(index);
+						float v_water = get_agent_default_variable_v_water(index);
+						float walk_speed = get_agent_default_variable_motion_speed(index); // reading the walking speed of pedestrians; it is different from speed, which remains constant
+						float body_height = get_agent_default_variable_body_height(index);
+						float body_mass = get_agent_default_variable_body_mass(index);
+						int gender = get_agent_default_variable_gender(index);
+						int age = get_agent_default_variable_age(index);
+
+						int exit_no = get_agent_default_variable_exit_no(index);
+
+						//// counting the number of pedestrians with different states
+
+						// uncomment below if statement to limit the outputs for peds with specific status
+						//if (pedestrians_state == HR_over_2p5 || pedestrians_state == HR_1p5_2p5 || pedestrians_state == HR_0p75_1p5)
+						//{
+							// print the global position of pedestians
+							fprintf(fp3, "%.3f\t\t%.3f\t\t%d\t\t%.3f\t\t%d\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t\t%d\n", (x - 1)*(0.5*xmax) + xmax, (y - 1)*(0.5*ymax) + ymax, HR_state, HR_ped, stability_state, d_water, v_water, walk_speed, body_height, body_mass, gender, age, exit_no);
+						//}
+					}
+					/////////////////////////////////////////////////////////////////////////
+
+				}
+				else
+				{
+					fprintf(stderr, "Error: file %s could not be created for customOutputStepFunction\n", outputFilename.c_str());
+
+					fprintf(stderr, "Error: file %s could not be created for customOutputStepFunction\n", outputFilename2.c_str());
+				}
+
+				if (fp2 != nullptr && fp2 != stdout && fp2 != stderr) {
+					fclose(fp2);
+					fp2 = nullptr;
+				}
+
+				if (fp3 != nullptr && fp3 != stdout && fp3 != stderr) {
+					fclose(fp3);
+					fp3 = nullptr;
+				}
+			} // simulation timing if statement end
+
+	// one frame per frame_output_interval, however many have been passed in this iteration
+	if (checkOutputSchedule(frame_output_schedule, new_sim_time) > 0)
+		outputFrame();
+
+}
+
+// Navigation fields of the exits, updated by updateNavigationFields when nav_reroute_on is ON
+NavigationField navigation_field;
+int navigation_field_ready = 0;
+std::vector<int> navigation_field_cells;		// grid cell (x + y*width) of each navmap agent index
+std::vector<float> navigation_exit_x;			// exit vectors of all navmap agents (index exit*count + agent index), as sent to the device
+std::vector<float> navigation_exit_y;
+std::vector<float> navigation_built_x;			// exit vectors of the navigation map built by the floor plan editor
+std::vector<float> navigation_built_y;
+unsigned int navigation_field_iteration = 0;	// iteration of the last update, to detect a restored checkpoint
+int navigation_upload_all = 0;					// copy the exit vectors of all cells to the device in the next update
+
+// gets the exit vector of a navmap agent for exit number exit_no (starting at 0), as the goal force in force_flow
+void getNavmapExitVector(int index, int exit_no, float* x, float* y)
+{
+	switch (exit_no)
+	{
+	case 0: *x = get_navmap_static_variable_exit0_x(index); *y = get_navmap_static_variable_exit0_y(index); break;
+	case 1: *x = get_navmap_static_variable_exit1_x(index); *y = get_navmap_static_variable_exit1_y(index); break;
+	case 2: *x = get_navmap_static_variable_exit2_x(index); *y = get_navmap_static_variable_exit2_y(index); break;
+	case 3: *x = get_navmap_static_variable_exit3_x(index); *y = get_navmap_static_variable_exit3_y(index); break;
+	case 4: *x = get_navmap_static_variable_exit4_x(index); *y = get_navmap_static_variable_exit4_y(index); break;
+	case 5: *x = get_navmap_static_variable_exit5_x(index); *y = get_navmap_static_variable_exit5_y(index); break;
+	case 6: *x = get_navmap_static_variable_exit6_x(index); *y = get_navmap_static_variable_exit6_y(index); break;
+	case 7: *x = get_navmap_static_variable_exit7_x(index); *y = get_navmap_static_variable_exit7_y(index); break;
+	case 8: *x = get_navmap_static_variable_exit8_x(index); *y = get_navmap_static_variable_exit8_y(index); break;
+	case 9: *x = get_navmap_static_variable_exit9_x(index); *y = get_navmap_static_variable_exit9_y(index); break;
+	default: *x = 0.0f; *y = 0.0f; break;
+	}
+}
+
+// gets the device arrays of the exit vectors of navmap agents for exit number exit_no (starting at 0)
+void getNavmapExitVectorDeviceArrays(int exit_no, float** x, float** y)
+{
+	xmachine_memory_navmap_list* d_navmaps = get_device_navmap_static_agents();
+
+	switch (exit_no)
+	{
+	case 0: *x = d_navmaps->exit0_x; *y = d_navmaps->exit0_y; break;
+	case 1: *x = d_navmaps->exit1_x; *y = d_navmaps->exit1_y; break;
+	case 2: *x = d_navmaps->exit2_x; *y = d_navmaps->exit2_y; break;
+	case 3: *x = d_navmaps->exit3_x; *y = d_navmaps->exit3_y; break;
+	case 4: *x = d_navmaps->exit4_x; *y = d_navmaps->exit4_y; break;
+	case 5: *x = d_navmaps->exit5_x; *y = d_navmaps->exit5_y; break;
+	case 6: *x = d_navmaps->exit6_x; *y = d_navmaps->exit6_y; break;
+	case 7: *x = d_navmaps->exit7_x; *y = d_navmaps->exit7_y; break;
+	case 8: *x = d_navmaps->exit8_x; *y = d_navmaps->exit8_y; break;
+	case 9: *x = d_navmaps->exit9_x; *y = d_navmaps->exit9_y; break;
+	default: *x = nullptr; *y = nullptr; break;
+	}
+}
+
+// Re-derives the exit vectors of navmap agents from distance fields in which the hazard of the floodwater and the sandbag dikes
+// are taken as the cost of walking through cells. The fields are built from the navigation map on the first call, every
+// 'nav_reroute_interval' iterations after that the cost of each cell is updated and only the regions whose cost changed are
+// solved again. Exit vectors are replaced only where the distances differ from those of the dry map, elsewhere the vectors
+// built by the floor plan editor are kept.
+__FLAME_GPU_STEP_FUNC__ void updateNavigationFields()
+{
+	if (*get_nav_reroute_on() == OFF)
+		return;
+
+	int interval = *get_nav_reroute_interval();
+	if (interval > 1 && (getIterationNumber() % interval) != 0)
+		return;
+
+	int no_navmap = get_agent_navmap_static_count();
+	int width = get_navmap_population_width();
+	int height = get_navmap_population_height();
+
+	// restoring a checkpoint (restore_simulation) moves the iteration number back and replaces the exit vectors on the device with
+	// those of the checkpoint, the fields are built again from the navigation map kept from the first build and all cells are sent
+	if (navigation_field_ready && getIterationNumber() < navigation_field_iteration)
+		navigation_field_ready = 0;
+	navigation_field_iteration = getIterationNumber();
+
+	// build the fields from the navigation map, a cell is part of the map of an exit if it has an exit vector or is a cell of the exit
+	if (!navigation_field_ready)
+	{
+		int rebuild = !navigation_built_x.empty();
+		initNavigationField(navigation_field, width, height, NUM_EXITS);
+		navigation_field_cells.resize(no_navmap);
+		navigation_built_x.resize(NUM_EXITS * no_navmap);
+		navigation_built_y.resize(NUM_EXITS * no_navmap);
+
+		for (int index = 0; index < no_navmap; index++)
+		{
+			int x = get_navmap_static_variable_x(index);
+			int y = get_navmap_static_variable_y(index);
+			int exit_no = get_navmap_static_variable_exit_no(index);
+			navigation_field_cells[index] = x + y * width;
+
+			for (int i = 0; i < NUM_EXITS; i++)
+			{
+				if (!rebuild)
+					getNavmapExitVector(index, i, &navigation_built_x[i * no_navmap + index], &navigation_built_y[i * no_navmap + index]);
+				float exit_x = navigation_built_x[i * no_navmap + index];
+				float exit_y = navigation_built_y[i * no_navmap + index];
+				setNavigationFieldCell(navigation_field, i, x, y, (exit_x != 0.0f || exit_y != 0.0f), (exit_no == i + 1));
+			}
+		}
+		solveNavigationField(navigation_field);
+
+		navigation_exit_x = navigation_built_x;
+		navigation_exit_y = navigation_built_y;
+		navigation_field_ready = 1;
+		navigation_upload_all = rebuild;
+	}
+
+	float hazard_weight = *get_nav_reroute_hazard_weight();
+	float block_HR = *get_nav_reroute_block_HR();
+	float block_z0 = *get_nav_reroute_block_z0();
+	int sandbagging_on = *get_sandbagging_on();
+	int drop_point = *get_drop_point();
+
+	// cost of each cell from the hazard rating of the water (in the same classes as the pedestrians' HR_state), cells with a
+	// hazard rating above nav_reroute_block_HR or with a sandbag dike higher than nav_reroute_block_z0 are blocked
+	for (int index = 0; index < no_navmap; index++)
+	{
+		double water_height = fabs(get_navmap_static_variable_h(index));
+		double water_velocity = 0.0;
+		if (water_height > epsilon)
+			water_velocity = fmax(fabs(get_navmap_static_variable_qx(index)), fabs(get_navmap_static_variable_qy(index))) / water_height;
+		double HR = water_height * (water_velocity + 0.5);
+
+		int HR_state = HR_zero;
+		if (HR > 2.5)
+			HR_state = HR_over_2p5;
+		else if (HR > 1.5)
+			HR_state = HR_1p5_2p5;
+		else if (HR > 0.75)
+			HR_state = HR_0p75_1p5;
+		else if (HR > epsilon)
+			HR_state = HR_0p0001_0p75;
+
+		float cost = 1.0f + hazard_weight * HR_state;
+
+		if (HR > block_HR)
+			cost = NAV_FIELD_BLOCKED;
+
+		if (sandbagging_on == ON && get_navmap_static_variable_z0(index) >= block_z0
+			&& (get_navmap_static_variable_drop_point(index) == ON || get_navmap_static_variable_exit_no(index) == drop_point))
+			cost = NAV_FIELD_BLOCKED;
+
+		int cell = navigation_field_cells[index];
+		setNavigationFieldCost(navigation_field, cell % width, cell / width, cost);
+	}
+
+	if (updateNavigationField(navigation_field) == 0 && !navigation_upload_all)
+		return;
+
+	// agent index of each grid cell, for the dirty cells of the fields
+	std::vector<int> cell_index(width * height, -1);
+	for (int index = 0; index < no_navmap; index++)
+		cell_index[navigation_field_cells[index]] = index;
+
+	for (int i = 0; i < NUM_EXITS; i++)
+	{
+		const std::vector<int>& dirty = navigation_field.dirty_cells[i];
+		if (dirty.empty() && !navigation_upload_all)
+			continue;
+
+		for (size_t d = 0; d < dirty.size(); d++)
+		{
+			int index = cell_index[dirty[d]];
+			if (index < 0)
+				continue;
+
+			int v = i * no_navmap + index;
+			float direction_x, direction_y;
+			if (getNavigationFieldDirection(navigation_field, i, dirty[d], &direction_x, &direction_y))
+			{
+				// keep the magnitude of the built vector (the exit force), 1 where the map had none
+				float force = sqrtf(navigation_built_x[v] * navigation_built_x[v] + navigation_built_y[v] * navigation_built_y[v]);
+				if (force == 0.0f)
+					force = 1.0f;
+				navigation_exit_x[v] = direction_x * force;
+				navigation_exit_y[v] = direction_y * force;
+			}
+			else
+			{
+				navigation_exit_x[v] = navigation_built_x[v];
+				navigation_exit_y[v] = navigation_built_y[v];
+			}
+		}
+
+		float* d_exit_x;
+		float* d_exit_y;
+		getNavmapExitVectorDeviceArrays(i, &d_exit_x, &d_exit_y);
+		if (cudaMemcpy(d_exit_x, &navigation_exit_x[i * no_navmap], no_navmap * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess
+			|| cudaMemcpy(d_exit_y, &navigation_exit_y[i * no_navmap], no_navmap * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess)
+		{
+			fprintf(stderr, "Error: could not copy the navigation field of exit %d to the device in updateNavigationFields\n", i + 1);
+			exit(EXIT_FAILURE);
+		}
+	}
+	navigation_upload_all = 0;
+}
+
+// outputting the flood envelope (maximum depth, velocity and hazard rating and the arrival time of water) of each flood agent at the end of the simulation
+__FLAME_GPU_EXIT_FUNC__ void outputFloodEnvelope()
+{
+	int flood_envelope_on = *get_flood_envelope_on();
 
-						// calculating local hazard rate
-						double hazard_rate = fabs(flow_h*(flow_velocity_xy + 0.5));
+	if (flood_envelope_on == OFF)
+		return;
 
-						
-						// NOTE: for outputing the cross sectional profile of water in the centre line of x-axis, 
-						// uncomment the if condition statement
-						// Otherwise, outputs of the entire flood grid
-						//int middle_pos = sqrt(no_FloodCells) / 2;
+	double dxl = *get_DXL();
+	double dyl = *get_DYL();
 
-						//if (x == middle_pos)
-						//{
-							fprintf(fp2, "%.3f\t\t%.3f\t\t%f\t\t%f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\n", x*dxl, y*dyl, flow_h, flow_velocity_xy, hazard_rate, flow_velocity_x, flow_velocity_y, z0);
-						// }
-					}
-					/////////////////////////////////////////////////////////////////////////
+	std::string outputFilename = std::string(std::string(getOutputDir()) + "flood_envelope.csv");
 
+	FILE * fp = fopen(outputFilename.c_str(), "w");
 
+	if (fp == nullptr)
+	{
+		fprintf(stderr, "Error: file %s could not be created for outputFloodEnvelope\n", outputFilename.c_str());
+		return;
+	}
 
-				//	//////////////////////////////// Outputting the location of pedestrians /////////////////////////////////////////
-					for (int index = 0; index < no_pedestrians; index++)
-					{
-						int HR_state = get_agent_default_variable_HR_state(index);
-						float x = get_agent_default_variable_x(index);
-						float y = get_agent_default_variable_y(index);
-						double xmax = *get_xmax();
-						double ymax = *get_ymax();
+	// Output a header row for the CSV, arrival time is -1 for the agents which have never been wet
+	fprintf(fp, "x,y,Max.Depth,Max.Velocity,Max.HR,Arrival.t\n");
 
-						double HR_ped = get_agent_default_variable_HR(index);
-						
-						int stability_state = get_agent_default_variable_stability_state(index);
-						float d_water = get_agent_default_variable_d_water(index);
-						float v_water = get_agent_default_variable_v_water(index);
-						float walk_speed = get_agent_default_variable_motion_speed(index); // reading the walking speed of pedestrians; it is different from speed, which remains constant
-						float body_height = get_agent_default_variable_body_height(index);
-						float body_mass = get_agent_default_variable_body_mass(index);
-						int gender = get_agent_default_variable_gender(index);
-						int age = get_agent_default_variable_age(index);
+	int no_FloodCells = get_agent_FloodCell_Default_count();
 
-						int exit_no = get_agent_default_variable_exit_no(index);
+	for (int index = 0; index < no_FloodCells; index++)
+	{
+		int x = get_FloodCell_Default_variable_x(index);
+		int y = get_FloodCell_Default_variable_y(index);
 
-						//// counting the number of pedestrians with different states
+		double arrival_time = get_FloodCell_Default_variable_envelope(index, ENVELOPE_ARRIVAL_TIME);
 
-						// uncomment below if statement to limit the outputs for peds with specific status
-						//if (pedestrians_state == HR_over_2p5 || pedestrians_state == HR_1p5_2p5 || pedestrians_state == HR_0p75_1p5)
-						//{
-							// print the global position of pedestians
-							fprintf(fp3, "%.3f\t\t%.3f\t\t%d\t\t%.3f\t\t%d\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%.3f\t\t%d\t\t%d\n", (x - 1)*(0.5*xmax) + xmax, (y - 1)*(0.5*ymax) + ymax, HR_state, HR_ped, stability_state, d_water, v_water, walk_speed, body_height, body_mass, gender, age, exit_no);
-						//}
-					}
-					/////////////////////////////////////////////////////////////////////////
+		fprintf(fp, "%.3f,%.3f,%f,%f,%f,%.3f\n", x*dxl, y*dyl,
+			get_FloodCell_Default_variable_envelope(index, ENVELOPE_MAX_H),
+			get_FloodCell_Default_variable_envelope(index, ENVELOPE_MAX_VELOCITY),
+			get_FloodCell_Default_variable_envelope(index, ENVELOPE_MAX_HR),
+			(arrival_time > 0.0) ? arrival_time : -1.0);
+	}
 
-				}
-				else
-				{
-					fprintf(stderr, "Error: file %s could not be created for customOutputStepFunction\n", outputFilename.c_str());
+	fclose(fp);
+}
 
-					fprintf(stderr, "Error: file %s could not be created for customOutputStepFunction\n", outputFilename2.c_str());
-				}
 
-				if (fp2 != nullptr && fp2 != stdout && fp2 != stderr) {
-					fclose(fp2);
-					fp2 = nullptr;
-				}
+// stopping the simulation before the last iteration once every enabled criterion holds (exit_condition_on): all pedestrians
+// have left the domain or are immobilised, the inflow has ended and the depth of water has been steady for a number of iterations
+__FLAME_GPU_EXIT_CONDITION__ int simulationFinished()
+{
+	if (*get_exit_condition_on() == OFF)
+		return CONTINUE;
 
-				if (fp3 != nullptr && fp3 != stdout && fp3 != stderr) {
-					fclose(fp3);
-					fp3 = nullptr;
-				}
-			} // simulation timing second if statement end
-		} // simulation timing first if statement end
+	// the steady flow criterion is updated every iteration as it counts consecutive iterations
+	int finished = 1;
+	double dh_tolerance = *get_exit_condition_dh_tolerance();
+	if (dh_tolerance > 0.0)
+	{
+		if (get_flood_max_dh_reduction() < dh_tolerance)
+			exit_condition_steady_count++;
+		else
+			exit_condition_steady_count = 0;
+
+		if (exit_condition_steady_count < *get_exit_condition_steady_iterations())
+			finished = 0;
+	}
+
+	if (*get_exit_condition_inflow_end_on() == ON && *get_sim_time() <= *get_inflow_end_time())
+		finished = 0;
+
+	if (*get_exit_condition_evacuated_on() == ON)
+	{
+		int no_pedestrians = get_agent_agent_default_count();
+		if (no_pedestrians > 0)
+			exit_condition_pedestrians_seen = 1;
+
+		// an empty domain is evacuated once the pedestrians have left, or from the start when no exit emits pedestrians (flood only runs)
+		bool emission = false;
+		for (int i = 0; i < NUM_EXITS; i++)
+			emission = emission || get_EMMISION_RATE_EXIT()[i] > 0.0f;
+
+		if (exit_condition_pedestrians_seen == 0 && emission)
+			finished = 0;
+		else if (finished && no_pedestrians > 0)
+		{
+			// pedestrians in deep and fast water (stability_state 4) cannot move, and neither can unstable ones if freeze_while_instable_on
+			unsigned int stability_histogram[5];
+			histogram_agent_default_stability_state_variable(stability_histogram, 5);
+
+			int immobile = stability_histogram[4];
+			if (*get_freeze_while_instable_on() == ON)
+				immobile += stability_histogram[1] + stability_histogram[2] + stability_histogram[3];
+
+			if (immobile < no_pedestrians)
+				finished = 0;
+		}
+	}
 
+	if (finished)
+	{
+		printf("\nSimulation finished at %f s\n", *get_sim_time());
+		return EXIT;
+	}
+
+	return CONTINUE;
 }
 
 
@@ -1497,6 +1838,26 @@ inline __device__ void Friction_Implicit(xmachine_memory_FloodCell* agent, doubl
 	}
 }
 
+// Level of local time stepping of a flood agent from its CFL time-step: the agent is stable when updated every 2^level sub-steps 
+// of dt (the minimum CFL time-step of the domain at the start of the cycle, see advanceLTSCycle), up to lts_max_level. Dry agents 
+// are at level 0, as the water can reach them at any sub-step.
+inline __device__ int LTS_Level(xmachine_memory_FloodCell* agent)
+{
+	int level = 0;
+
+	if (agent->h <= TOL_H)
+	{
+		return level;
+	}
+
+	while ((level < lts_max_level) && (agent->timeStep >= dt * (double)(2 << level)))
+	{
+		level++;
+	}
+
+	return level;
+}
+
 
 __FLAME_GPU_FUNC__ int PrepareWetDry(xmachine_memory_FloodCell* agent, xmachine_message_WetDryMessage_list* WerDryMessage_messages)
 {
@@ -1512,13 +1873,21 @@ __FLAME_GPU_FUNC__ int PrepareWetDry(xmachine_memory_FloodCell* agent, xmachine_
 
 
 		agent->minh_loc = hp;
+	}
 
+	// the levels of local time stepping are fixed at the start of each cycle, from the time-steps of the last updates
+	if ((lts_on == ON) && (lts_substep == 0))
+	{
+		agent->lts_level = LTS_Level(agent);
+	}
 
-		add_WetDryMessage_message<DISCRETE_2D>(WerDryMessage_messages, 1, agent->x, agent->y, agent->minh_loc);
+	if (agent->inDomain)
+	{
+		add_WetDryMessage_message<DISCRETE_2D>(WerDryMessage_messages, 1, agent->x, agent->y, agent->minh_loc, agent->lts_level);
 	}
 	else
 	{
-		add_WetDryMessage_message<DISCRETE_2D>(WerDryMessage_messages, 0, agent->x, agent->y, BIG_NUMBER);
+		add_WetDryMessage_message<DISCRETE_2D>(WerDryMessage_messages, 0, agent->x, agent->y, BIG_NUMBER, agent->lts_level);
 	}
 
 	return 0;
@@ -1552,6 +1921,13 @@ __FLAME_GPU_FUNC__ int ProcessWetDryMessage(xmachine_memory_FloodCell* agent, xm
 				maxHeight = msg->min_hloc;
 			}
 
+			// an agent is at most one level coarser than its neighbours, so that the water does not move past an agent 
+			// in between its updates (e.g. ahead of a bore). One pass is enough as lts_max_level is at most 2 (see initConstants)
+			if ((lts_on == ON) && (lts_substep == 0))
+			{
+				agent->lts_level = min(agent->lts_level, msg->lts_level + 1);
+			}
+
 			msg = get_next_WetDryMessage_message<DISCRETE_2D>(msg, WetDryMessage_messages);
 		}
 
@@ -1564,7 +1940,15 @@ __FLAME_GPU_FUNC__ int ProcessWetDryMessage(xmachine_memory_FloodCell* agent, xm
 		{
 
 			//	//Friction term has been disabled for radial deam-break
-			Friction_Implicit(agent, dt); //
+			// with local time stepping the friction is applied once per update window of the agent, at its start
+			if (lts_on == OFF)
+			{
+				Friction_Implicit(agent, dt); //
+			}
+			else if (lts_substep % (1 << agent->lts_level) == 0)
+			{
+				Friction_Implicit(agent, dt * (1 << agent->lts_level));
+			}
 
 		}
 		else
@@ -1786,7 +2170,8 @@ __FLAME_GPU_FUNC__ int PrepareSpaceOperator(xmachine_memory_FloodCell* agent, xm
 			agent->hFace_E, agent->etFace_E, agent->qxFace_E, agent->qyFace_E,
 			agent->hFace_W, agent->etFace_W, agent->qxFace_W, agent->qyFace_W,
 			agent->hFace_N, agent->etFace_N, agent->qxFace_N, agent->qyFace_N,
-			agent->hFace_S, agent->etFace_S, agent->qxFace_S, agent->qyFace_S
+			agent->hFace_S, agent->etFace_S, agent->qxFace_S, agent->qyFace_S,
+			agent->lts_level
 			);
 	}
 	else
@@ -1798,7 +2183,8 @@ __FLAME_GPU_FUNC__ int PrepareSpaceOperator(xmachine_memory_FloodCell* agent, xm
 			0.0, 0.0, 0.0, 0.0,
 			0.0, 0.0, 0.0, 0.0,
 			0.0, 0.0, 0.0, 0.0,
-			0.0, 0.0, 0.0, 0.0
+			0.0, 0.0, 0.0, 0.0,
+			agent->lts_level
 			);
 	}
 
@@ -2190,11 +2576,119 @@ inline __device__ double3 hll_y(double h_S, double h_N, double qx_S, double qx_N
 	//	
 }
 
+// Updates the flow of a flood agent by the given changes over its time-step, then secures zero velocities at the wet/dry front, 
+// stores the CFL time-step of the agent and updates its flood envelope
+inline __device__ void UpdateFloodCell(xmachine_memory_FloodCell* agent, double dh, double dqx, double dqy)
+{
+	// Update FV update function with adaptive timestep
+	double h_old = agent->h;
+	agent->h = agent->h + dh;
+	update_flood_max_dh_reduction(fabs(agent->h - h_old));
+	agent->qx = agent->qx + dqx;
+	agent->qy = agent->qy + dqy;
+
+
+	// Secure zero velocities at the wet/dry front
+	double hp = agent->h;
+
+	// Removes zero from taking the minumum of dt from the agents once it is checked in the next iteration 
+	// for those agents with hp < TOL_H , in other words assign big number to the dry cells (not retaining zero dt)
+	agent->timeStep = BIG_NUMBER;
+
+	//// ADAPTIVE TIME STEPPING
+	if (hp <= TOL_H)
+	{
+		agent->qx = 0.0;
+		agent->qy = 0.0;
+
+	}
+	else
+	{
+		double up = agent->qx / hp;
+		double vp = agent->qy / hp;
+
+		//store for timestep calc
+		agent->timeStep = fminf(CFL * DXL / (fabs(up) + sqrt(GRAVITY * hp)), CFL * DYL / (fabs(vp) + sqrt(GRAVITY * hp)));
+
+		// Updating the flood envelope of the agent in place (outputted once in outputFloodEnvelope), as an array variable it is only 
+		// read and written here, so runs without flood_envelope_on do not move it through the agent functions
+		if (flood_envelope_on == ON)
+		{
+			double velocity_xy = fmax(fabs(up), fabs(vp));
+			double hazard_rate = hp * (velocity_xy + 0.5);
+
+			double max_h = get_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_H);
+			double max_velocity = get_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_VELOCITY);
+			double max_HR = get_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_HR);
+			set_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_H, fmax(max_h, hp));
+			set_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_VELOCITY, fmax(max_velocity, velocity_xy));
+			set_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_MAX_HR, fmax(max_HR, hazard_rate));
+
+			// the time at the end of this update is taken as the arrival time of water
+			if (get_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_ARRIVAL_TIME) == 0.0 && hp > epsilon)
+			{
+				set_FloodCell_agent_array_value<double>(agent->envelope, ENVELOPE_ARRIVAL_TIME, sim_time + dt);
+			}
+		}
+
+	}
+
+	// the CFL time-step and depth of water of the domain, used by DELTA_T_func for the next time-step
+	update_flood_min_timeStep_reduction(agent->timeStep);
+	update_flood_max_h_reduction(hp);
+}
+
+// Time over which the flux of a face of the given level of local time stepping is taken at the current sub-step: the 2^level 
+// sub-steps until the face is due again, or zero if the face is not due. Both agents of a face take its flux at the same sub-steps 
+// over the same time, so that the water is conserved across the levels.
+inline __device__ double LTS_FaceTime(int level)
+{
+	if (lts_substep % (1 << level) == 0)
+	{
+		return dt * (1 << level);
+	}
+
+	return 0.0;
+}
+
+// Ends the sub-step of local time stepping of a flood agent: at the last sub-step of its update window, the changes accumulated 
+// from its faces are applied. Otherwise the agent keeps its flow until then (it still takes part in the reductions of the domain).
+inline __device__ int LTS_FinishSubstep(xmachine_memory_FloodCell* agent)
+{
+	if ((lts_substep + 1) % (1 << agent->lts_level) == 0)
+	{
+		UpdateFloodCell(agent, agent->lts_acc_h, agent->lts_acc_qx, agent->lts_acc_qy);
+
+		agent->lts_acc_h = 0.0;
+		agent->lts_acc_qx = 0.0;
+		agent->lts_acc_qy = 0.0;
+	}
+	else
+	{
+		update_flood_min_timeStep_reduction(agent->timeStep);
+		update_flood_max_h_reduction(agent->h);
+	}
+
+	return 0;
+}
+
 __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* agent, xmachine_message_SpaceOperatorMessage_list* SpaceOperatorMessage_messages)
 {
 	// This function updates the state of flood agents by solving shallow water equations (SWEs) aiming Finite Volume (FV) method 
 	// Boundary condition is considered within this function
 
+	// with local time stepping the fluxes are only evaluated at the sub-steps where a face of the agent is due
+	if ((lts_on == ON) && (lts_substep % (1 << agent->lts_level_min) != 0))
+	{
+		return LTS_FinishSubstep(agent);
+	}
+
+	// levels of local time stepping of the faces, the finer of the two agents of a face (the domain boundaries take the agent's)
+	int lts_level_E = agent->lts_level;
+	int lts_level_W = agent->lts_level;
+	int lts_level_N = agent->lts_level;
+	int lts_level_S = agent->lts_level;
+
 	double3 FPlus = make_double3(0.0, 0.0, 0.0);
 	double3 FMinus = make_double3(0.0, 0.0, 0.0);
 	double3 GPlus = make_double3(0.0, 0.0, 0.0);
@@ -2554,6 +3048,20 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 	while (msg)
 
 	{
+		if (lts_on == ON)
+		{
+			int face_level = min(agent->lts_level, msg->lts_level);
+
+			if ((msg->x - 1 == agent->x) && (agent->y == msg->y))
+				lts_level_E = face_level;
+			else if ((msg->x + 1 == agent->x) && (agent->y == msg->y))
+				lts_level_W = face_level;
+			else if ((msg->x == agent->x) && (agent->y == msg->y - 1))
+				lts_level_N = face_level;
+			else if ((msg->x == agent->x) && (agent->y == msg->y + 1))
+				lts_level_S = face_level;
+		}
+
 		if (msg->inDomain)
 		{
 			//  Local EAST values and Neighbours' WEST Values are NEEDED
@@ -2562,8 +3070,8 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 			if (msg->x - 1 == agent->x
 				&& agent->y == msg->y)
 			{
-				double& h_R = msg->hFace_W;
-				double& et_R = msg->etFace_W;
+				double h_R = msg->hFace_W;
+				double et_R = msg->etFace_W;
 				double2 q_R = make_double2(msg->qFace_X_W, msg->qFace_Y_W);
 
 
@@ -2604,8 +3112,8 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 				{
 					// Local WEST, Neighbour EAST
 					// West PART (Minus x direction)
-					double& h_L = msg->hFace_E;
-					double& et_L = msg->etFace_E;
+					double h_L = msg->hFace_E;
+					double et_L = msg->etFace_E;
 					double2 q_L = make_double2(msg->qFace_X_E, msg->qFace_Y_E);
 
 
@@ -2642,8 +3150,8 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 					{
 						//Local NORTH, Neighbour SOUTH
 						// North Part (Plus Y direction)
-						double& h_R = msg->hFace_S;
-						double& et_R = msg->etFace_S;
+						double h_R = msg->hFace_S;
+						double et_R = msg->etFace_S;
 						double2 q_R = make_double2(msg->qFace_X_S, msg->qFace_Y_S);
 
 
@@ -2683,8 +3191,8 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 						{
 							//Local SOUTH, Neighbour NORTH
 							// South part (Minus y direction)
-							double& h_L = msg->hFace_N;
-							double& et_L = msg->etFace_N;
+							double h_L = msg->hFace_N;
+							double et_L = msg->etFace_N;
 							double2 q_L = make_double2(msg->qFace_X_N, msg->qFace_Y_N);
 
 							double h_R = agent->hFace_S;
@@ -2721,6 +3229,12 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 		msg = get_next_SpaceOperatorMessage_message<DISCRETE_2D>(msg, SpaceOperatorMessage_messages);
 	}
 
+	// the faces (and thus the sub-steps this agent is evaluated at) are fixed for the cycle
+	if ((lts_on == ON) && (lts_substep == 0))
+	{
+		agent->lts_level_min = min(min(lts_level_E, lts_level_W), min(lts_level_N, lts_level_S));
+	}
+
 	// Topography slope
 	double z1x_bar = (zbF_E - zbF_W) / 2.0;
 	double z1y_bar = (zbF_N - zbF_S) / 2.0;
@@ -2754,35 +3268,26 @@ __FLAME_GPU_FUNC__ int ProcessSpaceOperatorMessage(xmachine_memory_FloodCell* ag
 	double SS_2 = (-GRAVITY * h0x_bar * 2.0 * z1x_bar) / DXL;
 	double SS_3 = (-GRAVITY * h0y_bar * 2.0 * z1y_bar) / DYL;
 
-	// Update FV update function with adaptive timestep
-	agent->h = agent->h - (dt / DXL) * (FPlus.x - FMinus.x) - (dt / DYL) * (GPlus.x - GMinus.x) + dt * SS_1;
-	agent->qx = agent->qx - (dt / DXL) * (FPlus.y - FMinus.y) - (dt / DYL) * (GPlus.y - GMinus.y) + dt * SS_2;
-	agent->qy = agent->qy - (dt / DXL) * (FPlus.z - FMinus.z) - (dt / DYL) * (GPlus.z - GMinus.z) + dt * SS_3;
-
-
-	// Secure zero velocities at the wet/dry front
-	double hp = agent->h;
-
-	// Removes zero from taking the minumum of dt from the agents once it is checked in the next iteration 
-	// for those agents with hp < TOL_H , in other words assign big number to the dry cells (not retaining zero dt)
-	agent->timeStep = BIG_NUMBER;
-
-	//// ADAPTIVE TIME STEPPING
-	if (hp <= TOL_H)
+	if (lts_on == ON)
 	{
-		agent->qx = 0.0;
-		agent->qy = 0.0;
-
+		// each due face is taken over the time until it is due again, the source terms over the update window of the agent
+		double dt_E = LTS_FaceTime(lts_level_E);
+		double dt_W = LTS_FaceTime(lts_level_W);
+		double dt_N = LTS_FaceTime(lts_level_N);
+		double dt_S = LTS_FaceTime(lts_level_S);
+		double dt_cell = LTS_FaceTime(agent->lts_level);
+
+		agent->lts_acc_h = agent->lts_acc_h - (dt_E * FPlus.x - dt_W * FMinus.x) / DXL - (dt_N * GPlus.x - dt_S * GMinus.x) / DYL + dt_cell * SS_1;
+		agent->lts_acc_qx = agent->lts_acc_qx - (dt_E * FPlus.y - dt_W * FMinus.y) / DXL - (dt_N * GPlus.y - dt_S * GMinus.y) / DYL + dt_cell * SS_2;
+		agent->lts_acc_qy = agent->lts_acc_qy - (dt_E * FPlus.z - dt_W * FMinus.z) / DXL - (dt_N * GPlus.z - dt_S * GMinus.z) / DYL + dt_cell * SS_3;
+
+		return LTS_FinishSubstep(agent);
 	}
-	else
-	{
-		double up = agent->qx / hp;
-		double vp = agent->qy / hp;
-
-		//store for timestep calc
-		agent->timeStep = fminf(CFL * DXL / (fabs(up) + sqrt(GRAVITY * hp)), CFL * DYL / (fabs(vp) + sqrt(GRAVITY * hp)));
 
-	}
+	UpdateFloodCell(agent,
+		- (dt / DXL) * (FPlus.x - FMinus.x) - (dt / DYL) * (GPlus.x - GMinus.x) + dt * SS_1,
+		- (dt / DXL) * (FPlus.y - FMinus.y) - (dt / DYL) * (GPlus.y - GMinus.y) + dt * SS_2,
+		- (dt / DXL) * (FPlus.z - FMinus.z) - (dt / DYL) * (GPlus.z - GMinus.z) + dt * SS_3);
 
 	return 0;
 }
@@ -2945,50 +3450,22 @@ __FLAME_GPU_FUNC__ int updateNavmap(xmachine_memory_navmap* agent, xmachine_mess
 
 __FLAME_GPU_FUNC__ int getNewExitLocation(RNG_rand48* rand48){
 
-	int exit1_compare  = EXIT1_PROBABILITY;
-	int exit2_compare  = EXIT2_PROBABILITY  + exit1_compare;
-	int exit3_compare  = EXIT3_PROBABILITY  + exit2_compare;
-	int exit4_compare  = EXIT4_PROBABILITY  + exit3_compare;
-	int exit5_compare  = EXIT5_PROBABILITY  + exit4_compare;
-	int exit6_compare  = EXIT6_PROBABILITY  + exit5_compare;
-	int exit7_compare  = EXIT7_PROBABILITY  + exit6_compare; 
-	int exit8_compare  = EXIT8_PROBABILITY  + exit7_compare; 
-	int exit9_compare  = EXIT9_PROBABILITY  + exit8_compare; 
-
-
-	float range = (float) (EXIT1_PROBABILITY +
-				  EXIT2_PROBABILITY +
-				  EXIT3_PROBABILITY +
-				  EXIT4_PROBABILITY +
-				  EXIT5_PROBABILITY +
-				  EXIT6_PROBABILITY +
-				  EXIT7_PROBABILITY +
-				  EXIT8_PROBABILITY +
-				  EXIT9_PROBABILITY +
-				  EXIT10_PROBABILITY);
+	float range = 0.0f;
+	for (int i = 0; i < NUM_EXITS; i++)
+		range += EXIT_PROBABILITY[i];
 
 	float rand = rnd<DISCRETE_2D>(rand48)*range;
 
-	if (rand < exit1_compare)
-		return 1;
-	else if (rand < exit2_compare)
-		return 2;
-	else if (rand < exit3_compare)
-		return 3;
-	else if (rand < exit4_compare)
-		return 4;
-	else if (rand < exit5_compare)
-		return 5;
-	else if (rand < exit6_compare)
-		return 6;
-	else if (rand < exit7_compare)
-		return 7;					//added by MS 12102018
-	else if (rand < exit8_compare)	//added by MS 12102018
-		return 8;					//added by MS 12102018
-	else if (rand < exit9_compare)	//added by MS 12102018
-		return 9;					//added by MS 12102018
-	else                            //added by MS 12102018
-		return 10;					//added by MS 12102018
+	// walk the cumulative probabilities until the random value falls within an exit's share
+	int exit_compare = 0;
+	for (int i = 0; i < NUM_EXITS - 1; i++)
+	{
+		exit_compare += EXIT_PROBABILITY[i];
+		if (rand < exit_compare)
+			return i + 1;
+	}
+
+	return NUM_EXITS;
 
 }
 
@@ -3272,10 +3749,11 @@ __FLAME_GPU_FUNC__ int force_flow(xmachine_memory_agent* agent, xmachine_message
 	/*int x = floor(((agent->x+ENV_MAX)/ENV_WIDTH)*d_message_navmap_cell_width);
 	int y = floor(((agent->y+ENV_MAX)/ENV_WIDTH)*d_message_navmap_cell_width);*/
 
-	// modified position of pedestrian agents
-	//  x and y has been swapped so as flid the navigation grid for spatial synchoranisation with flood agents' grid (MS02102018)
-	int x = floor(((agent->y + ENV_MAX) / ENV_WIDTH)*d_message_navmap_cell_width); 
-	int y = floor(((agent->x + ENV_MAX) / ENV_WIDTH)*d_message_navmap_cell_width);
+	// x is along the width of the navigation grid and y along its height, as where generate_pedestrians places pedestrians and 
+	// where updateNavmapData and the visualisation locate navmap agents (the x and y swap of MS02102018 only agreed with them on 
+	// square grids)
+	int x = floor(((agent->x + ENV_MAX) / ENV_WIDTH)*d_message_navmap_cell_width);
+	int y = floor(((agent->y + ENV_MAX) / ENV_WIDTH)*d_message_navmap_cell_height);
 
 	//lookup single message
     xmachine_message_navmap_cell* current_message = get_first_navmap_cell_message<CONTINUOUS>(navmap_cell_messages, x, y);
@@ -3380,104 +3858,33 @@ __FLAME_GPU_FUNC__ int force_flow(xmachine_memory_agent* agent, xmachine_message
 	glm::vec2 goal_force;
 
 	if (agent->exit_no == 1)
-	{
 		goal_force = glm::vec2(current_message->exit0_x, current_message->exit0_y);
-		if (exit_location == 1)
-			if (EXIT1_STATE == 1) //EXIT1_PROBABILITY != 0 prevents killing agents while flooding at the exits (MAY need to use for sandbagging test is added MS08102018)
-				kill_agent = 1;	
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-	}
 	else if (agent->exit_no == 2)
-	{
 		goal_force = glm::vec2(current_message->exit1_x, current_message->exit1_y);
-		if (exit_location == 2)
-			if (EXIT2_STATE == 1)
-				kill_agent = 1;
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 3)
-	{
 		goal_force = glm::vec2(current_message->exit2_x, current_message->exit2_y);
-		if (exit_location == 3)
-			if (EXIT3_STATE == 1)
-				kill_agent = 1;		
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 4)
-	{
 		goal_force = glm::vec2(current_message->exit3_x, current_message->exit3_y);
-		if (exit_location == 4)
-			if (EXIT4_STATE == 1)
-				kill_agent = 1;	
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 5)
-	{
 		goal_force = glm::vec2(current_message->exit4_x, current_message->exit4_y);
-		if (exit_location == 5)
-			if (EXIT5_STATE == 1)
-				kill_agent = 1;					
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 6)
-	{
 		goal_force = glm::vec2(current_message->exit5_x, current_message->exit5_y);
-		if (exit_location == 6)
-			if (EXIT6_STATE == 1)
-				kill_agent = 1;	
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 7)
-	{
 		goal_force = glm::vec2(current_message->exit6_x, current_message->exit6_y);
-		if (exit_location == 7)
-			if (EXIT7_STATE == 1)
-				kill_agent = 1;
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 8)
-	{
 		goal_force = glm::vec2(current_message->exit7_x, current_message->exit7_y);
-		if (exit_location == 8)
-			if (EXIT8_STATE == 1)
-				kill_agent = 1;
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 9)
-	{
 		goal_force = glm::vec2(current_message->exit8_x, current_message->exit8_y);
-		if (exit_location == 9)
-			if (EXIT9_STATE == 1)
-				kill_agent = 1;
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
-	}
 	else if (agent->exit_no == 10)
-	{
 		goal_force = glm::vec2(current_message->exit9_x, current_message->exit9_y);
-		if (exit_location == 10)
-			if (EXIT10_STATE == 1)
-				kill_agent = 1;
-						
-			else
-				agent->exit_no = getNewExitLocation(rand48);
-				
+
+	// once the agent reaches its destination exit it leaves the domain if the exit is open, otherwise another exit is chosen
+	if ((agent->exit_no >= 1) && (agent->exit_no <= NUM_EXITS) && (exit_location == agent->exit_no))
+	{
+		if (EXIT_STATE[agent->exit_no - 1] == 1) //EXIT_PROBABILITY != 0 prevents killing agents while flooding at the exits (MAY need to use for sandbagging test is added MS08102018)
+			kill_agent = 1;
+		else
+			agent->exit_no = getNewExitLocation(rand48);
 	}
 
 	
@@ -4034,25 +4441,7 @@ __FLAME_GPU_FUNC__ int generate_pedestrians(xmachine_memory_navmap* agent, xmach
 		float random = rnd<DISCRETE_2D>(rand48);
 		bool emit_agent = false;
 
-		if ((agent->exit_no == 1)&&((random < EMMISION_RATE_EXIT1*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 2)&&((random <EMMISION_RATE_EXIT2*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 3)&&((random <EMMISION_RATE_EXIT3*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 4)&&((random <EMMISION_RATE_EXIT4*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 5)&&((random <EMMISION_RATE_EXIT5*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 6)&&((random <EMMISION_RATE_EXIT6*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 7)&&((random <EMMISION_RATE_EXIT7*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 8) && ((random <EMMISION_RATE_EXIT8*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 9) && ((random <EMMISION_RATE_EXIT9*TIME_SCALER)))
-			emit_agent = true;
-		if ((agent->exit_no == 10) && ((random <EMMISION_RATE_EXIT10*TIME_SCALER)))
+		if ((agent->exit_no <= NUM_EXITS) && (random < EMMISION_RATE_EXIT[agent->exit_no - 1]*TIME_SCALER))
 			emit_agent = true;
 
 
@@ -4065,7 +4454,7 @@ __FLAME_GPU_FUNC__ int generate_pedestrians(xmachine_memory_navmap* agent, xmach
 
 
 			float x = ((agent->x+0.5f)/(d_message_navmap_cell_width/ENV_WIDTH))-ENV_MAX;
-			float y = ((agent->y+0.5f)/(d_message_navmap_cell_width/ENV_WIDTH))-ENV_MAX;
+			float y = ((agent->y+0.5f)/(d_message_navmap_cell_height/ENV_WIDTH))-ENV_MAX;
 			
 			int exit = getNewExitLocation(rand48);
 			
@@ -128,7 +128,8 @@ int initGL()
     // initialize necessary OpenGL extensions
     glewInit();
     if (! glewIsSupported( "GL_VERSION_2_0 " 
-        "GL_ARB_pixel_buffer_object"
+        "GL_ARB_pixel_buffer_object "
+        "GL_ARB_draw_instanced"
 		)) {
         fprintf( stderr, "ERROR: Support for necessary OpenGL extensions missing.");
         fflush( stderr);
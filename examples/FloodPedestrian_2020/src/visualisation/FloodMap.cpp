@@ -29,8 +29,7 @@ int drawFloodMap  = 1;
 bool view_water = true;
 
 // bo variables
-GLuint sphereVerts;
-GLuint sphereNormals;
+GLuint cellQuadVerts;
 
 //Simulation output buffers/textures
 cudaGraphicsResource_t FloodCell_Default_cgr;
@@ -43,20 +42,21 @@ GLuint vertexShader;
 GLuint fragmentShader;
 GLuint shaderProgram;
 GLuint vs_displacementMap;
-GLuint vs_mapIndex;
 GLuint vs_water;
 GLuint vs_NM_WIDTH;
+GLuint vs_NM_HEIGHT;
 GLuint vs_ENV_MAX;
 GLuint vs_ENV_WIDTH;
 
 int initGL();
 void initShader();
 void setVertexBufferData();
-static void setSphereVertex(glm::vec3*, int, int);
 
 //external prototypes imported from FLAME GPU
 extern int get_agent_FloodCell_MAX_count();
 extern int get_agent_FloodCell_Default_count();
+extern int get_FloodCell_population_width();
+extern int get_FloodCell_population_height();
 
 
 void initFloodMap()
@@ -64,9 +64,8 @@ void initFloodMap()
 	//init shader
 	initShader();
 
-	// create VBO's
-	createVBO(&sphereVerts, GL_ARRAY_BUFFER, SPHERE_SLICES* (SPHERE_STACKS + 1) * sizeof(glm::vec3));
-	createVBO(&sphereNormals, GL_ARRAY_BUFFER, SPHERE_SLICES* (SPHERE_STACKS + 1) * sizeof(glm::vec3));
+	// create VBO (a single cell, instanced once per flood cell)
+	createVBO(&cellQuadVerts, GL_ARRAY_BUFFER, CELL_QUAD_VERTICES * sizeof(glm::vec3));
 	setVertexBufferData();
 
 	// create TBO
@@ -92,25 +91,16 @@ void renderFloodMap()
 	//set water or h0 mode
 	glUniform1i(vs_water, view_water);
 
-	//loop
-	for (int i = 0; i< get_agent_FloodCell_Default_count(); i++) {
-		glVertexAttrib1f(vs_mapIndex, (float)i);
+	//draw all cells in a single call, the instance id is the index of the cell in the texture buffer
+	glEnableClientState(GL_VERTEX_ARRAY);
 
-		//draw using vertex and attribute data on the gpu (fast)
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_NORMAL_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, cellQuadVerts);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, sphereVerts);
-		glVertexPointer(3, GL_FLOAT, 0, 0);
+	glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, CELL_QUAD_VERTICES, get_agent_FloodCell_Default_count());
 
-		glBindBuffer(GL_ARRAY_BUFFER, sphereNormals);
-		glNormalPointer(GL_FLOAT, 0, 0);
-
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, SPHERE_SLICES * (SPHERE_STACKS + 1));
-
-		glDisableClientState(GL_NORMAL_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	glUseProgram(0);
 	
@@ -165,14 +155,14 @@ void initShader()
 
 	// get shader variables
 	vs_displacementMap = glGetUniformLocation(shaderProgram, "displacementMap");
-	vs_mapIndex = glGetAttribLocation(shaderProgram, "mapIndex");
 	vs_water = glGetUniformLocation(shaderProgram, "water");
 	vs_NM_WIDTH = glGetUniformLocation(shaderProgram, "FM_WIDTH");
+	vs_NM_HEIGHT = glGetUniformLocation(shaderProgram, "FM_HEIGHT");
 	vs_ENV_MAX = glGetUniformLocation(shaderProgram, "ENV_MAX");
 	vs_ENV_WIDTH = glGetUniformLocation(shaderProgram, "ENV_WIDTH");
 
-	int fm_width = (int)floor(sqrt((float)get_agent_FloodCell_MAX_count()));
-	glUniform1f(vs_NM_WIDTH, (float)fm_width);
+	glUniform1f(vs_NM_WIDTH, (float)get_FloodCell_population_width());
+	glUniform1f(vs_NM_HEIGHT, (float)get_FloodCell_population_height());
 	glUniform1f(vs_ENV_MAX, ENV_MAX);
 	glUniform1f(vs_ENV_WIDTH, ENV_WIDTH);
 	glUseProgram(0);
@@ -180,58 +170,24 @@ void initShader()
 }
 
 
-static void setSphereNormal(glm::vec3* data, int slice, int stack) {
-	float PI = 3.14159265358;
-
-	double sl = 2 * PI*slice / SPHERE_SLICES;
-	double st = 2 * PI*stack / SPHERE_STACKS;
-
-	data->x = cos(st)*sin(sl);
-	data->y = sin(st)*sin(sl);
-	data->z = cos(sl);
-}
-
 void setVertexBufferData()
 {
-	int slice, stack;
-	int i;
+	// corners of a cell (in cells, centred on the origin) as a triangle strip
+	const glm::vec3 corners[CELL_QUAD_VERTICES] = {
+		glm::vec3(-0.5f, -0.5f, 0.0f),
+		glm::vec3(0.5f, -0.5f, 0.0f),
+		glm::vec3(-0.5f, 0.5f, 0.0f),
+		glm::vec3(0.5f, 0.5f, 0.0f)
+	};
 
 	// upload vertex points data
-	glBindBuffer(GL_ARRAY_BUFFER, sphereVerts);
+	glBindBuffer(GL_ARRAY_BUFFER, cellQuadVerts);
 	glm::vec3* verts = (glm::vec3*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-	i = 0;
-	for (slice = 0; slice<SPHERE_SLICES / 2; slice++) {
-		for (stack = 0; stack <= SPHERE_STACKS; stack++) {
-			setSphereVertex(&verts[i++], slice, stack);
-			setSphereVertex(&verts[i++], slice + 1, stack);
-		}
-	}
-	glUnmapBuffer(GL_ARRAY_BUFFER);
-
-	// upload vertex normal data
-	glBindBuffer(GL_ARRAY_BUFFER, sphereNormals);
-	glm::vec3* normals = (glm::vec3*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-	i = 0;
-	for (slice = 0; slice<SPHERE_SLICES / 2; slice++) {
-		for (stack = 0; stack <= SPHERE_STACKS; stack++) {
-			setSphereNormal(&normals[i++], slice, stack);
-			setSphereNormal(&normals[i++], slice + 1, stack);
-		}
+	for (int i = 0; i < CELL_QUAD_VERTICES; i++) {
+		verts[i] = corners[i];
 	}
 	glUnmapBuffer(GL_ARRAY_BUFFER);
-}
-
-
-
-static void setSphereVertex(glm::vec3* data, int slice, int stack) {
-	float PI = 3.14159265358;
-
-	double sl = 2 * PI*slice / SPHERE_SLICES;
-	double st = 2 * PI*stack / SPHERE_STACKS;
-
-	data->x = cos(st)*sin(sl) * SPHERE_RADIUS;
-	data->y = sin(st)*sin(sl) * SPHERE_RADIUS;
-	data->z = cos(sl) * SPHERE_RADIUS;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
@@ -82,10 +82,9 @@ extern void generate_instances(cudaGraphicsResource_t * instances_cgr)
 	{
 		//centralise
 		//discrete variables
-		int population_width = (int)floor(sqrt((float)get_agent_FloodCell_Default_count()));
 		glm::vec3 centralise;
-		centralise.x = population_width / 2.0;
-		centralise.y = population_width / 2.0;
+		centralise.x = get_FloodCell_population_width() / 2.0;
+		centralise.y = get_FloodCell_population_height() / 2.0;
 		centralise.z = 0.0;
 
 		// map OpenGL buffer object for writing from CUDA
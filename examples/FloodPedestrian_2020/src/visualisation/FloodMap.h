@@ -28,7 +28,8 @@ typedef enum FLOODMAP_VIEW_MODE FLOODMAP_VIEW_MODE;
 void initFloodMap();
 
 /** renderFloodMap
- * Renders the flood Map by outputting agent data to a texture buffer object and then using vertex texture instancing 
+ * Renders the flood Map by outputting agent data to a texture buffer object and then drawing a quad per flood cell in a single
+ * instanced draw call, the vertex shader reads the position and colour of each instance from the texture buffer
  */
 void renderFloodMap();
 
@@ -63,35 +64,32 @@ extern void generate_instances(cudaGraphicsResource_t * instances_cgr);
 #define H_MIN 0.0f
 #define H_MAX 0.02f // 0.01f
 
-//Circle model fidelity
-const int SPHERE_SLICES = 8;
-const int SPHERE_STACKS = 8;
-const double SPHERE_RADIUS = 0.02;
+//Vertices of the quad drawn for each flood cell (a triangle strip)
+const int CELL_QUAD_VERTICES = 4;
 
-/** Vertex Shader source for rendering directional arrows */
+/** Vertex Shader source for rendering the flood cells, one instance per cell */
 static const char floodmap_vshader_source[] =
 {
 	"#extension GL_EXT_gpu_shader4 : enable										\n"
+	"#extension GL_ARB_draw_instanced : enable									\n"
 	"uniform samplerBuffer displacementMap;										\n"
-	"attribute in float mapIndex;												\n"
 	"uniform bool water;														\n"
 	"uniform float FM_WIDTH;													\n"
+	"uniform float FM_HEIGHT;													\n"
 	"uniform float ENV_MAX;														\n"
 	"uniform float ENV_WIDTH;													\n"
 	"void main()																\n"
 	"{																			\n"
 	"	vec4 position = gl_Vertex;											    \n"
-	"	vec4 lookup = texelFetchBuffer(displacementMap, (int)mapIndex);		    \n"
+	"	vec4 lookup = texelFetchBuffer(displacementMap, gl_InstanceIDARB);	    \n"
 	"	//if (water)	               											\n"
 	"		gl_FrontColor = vec4(1.0f-lookup.w, 1.0f-lookup.w, 1.0f, 0.0);	\n"
 	"	//else	                												\n"
 	"		gl_FrontColor += vec4(lookup.z, lookup.z, lookup.z, 0.0);			\n"
 	"	//lookup.w = 1.0;												    	\n"
-	"   //offset model position													\n"
-	"	float x_displace = ((lookup.x+0.5)/(FM_WIDTH/ENV_WIDTH))-ENV_MAX;		\n"
-	"	float y_displace = ((lookup.y+0.5)/(FM_WIDTH/ENV_WIDTH))-ENV_MAX;		\n"
-	"   position.x += x_displace;												\n"
-	"   position.y += y_displace;												\n"
+	"   //offset the cell corner (in cells) to the cell and scale to the environment	\n"
+	"	position.x = ((position.x+lookup.x+0.5)/(FM_WIDTH/ENV_WIDTH))-ENV_MAX;	\n"
+	"	position.y = ((position.y+lookup.y+0.5)/(FM_HEIGHT/ENV_WIDTH))-ENV_MAX;	\n"
 	"   position.z += 0.05;												\n"
 
 	"   gl_Position = gl_ModelViewProjectionMatrix * position;		    		\n"
@@ -29,29 +29,10 @@
 #endif
 
 //globals, initialised to 0 then loaded from the relevant variable as specified in the model or initial states file (or init function)
-float emmisionRateExit1 = 0;
-float emmisionRateExit2 = 0;
-float emmisionRateExit3 = 0;
-float emmisionRateExit4 = 0;
-float emmisionRateExit5 = 0;
-float emmisionRateExit6 = 0;
-float emmisionRateExit7 = 0;
-
-int exitProbability1 = 0;
-int exitProbability2 = 0;
-int exitProbability3 = 0;
-int exitProbability4 = 0;
-int exitProbability5 = 0;
-int exitProbability6 = 0;
-int exitProbability7 = 0;
-
-int exitState1 = 0;
-int exitState2 = 0;
-int exitState3 = 0;
-int exitState4 = 0;
-int exitState5 = 0;
-int exitState6 = 0;
-int exitState7 = 0;
+//element i of each array corresponds to exit number i+1
+float emmisionRateExit[NUM_EXITS] = { 0 };
+int exitProbability[NUM_EXITS] = { 0 };
+int exitState[NUM_EXITS] = { 0 };
 
 float timeScaler = 0;
 
@@ -61,29 +42,9 @@ float collisionWeight = 0;
 float goalWeight = 0;
 
 //imported functions from FLAME GPU
-extern void set_EMMISION_RATE_EXIT1(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT2(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT3(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT4(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT5(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT6(float* h_EMMISION_RATE);
-extern void set_EMMISION_RATE_EXIT7(float* h_EMMISION_RATE);
-
-extern void set_EXIT1_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT2_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT3_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT4_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT5_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT6_PROBABILITY(int* h_PROBABILITY);
-extern void set_EXIT7_PROBABILITY(int* h_PROBABILITY);
-
-extern void set_EXIT1_STATE(int* h_STATE);
-extern void set_EXIT2_STATE(int* h_STATE);
-extern void set_EXIT3_STATE(int* h_STATE);
-extern void set_EXIT4_STATE(int* h_STATE);
-extern void set_EXIT5_STATE(int* h_STATE);
-extern void set_EXIT6_STATE(int* h_STATE);
-extern void set_EXIT7_STATE(int* h_STATE);
+extern void set_EMMISION_RATE_EXIT(float* h_EMMISION_RATE);
+extern void set_EXIT_PROBABILITY(int* h_PROBABILITY);
+extern void set_EXIT_STATE(int* h_STATE);
 
 extern void set_TIME_SCALER(float* h_EMMISION_RATE);
 
@@ -92,37 +53,10 @@ extern void set_AVOID_WEIGHT(float* h_weight);
 extern void set_COLLISION_WEIGHT(float* h_weight);
 extern void set_GOAL_WEIGHT(float* h_weight);
 
-extern const float * get_EMMISION_RATE_EXIT1();
-extern const float * get_EMMISION_RATE_EXIT2();
-extern const float * get_EMMISION_RATE_EXIT3();
-extern const float * get_EMMISION_RATE_EXIT4();
-extern const float * get_EMMISION_RATE_EXIT5();
-extern const float * get_EMMISION_RATE_EXIT6();
-extern const float * get_EMMISION_RATE_EXIT7();
-
-extern const int * get_EXIT1_PROBABILITY();
-extern const int * get_EXIT2_PROBABILITY();
-extern const int * get_EXIT3_PROBABILITY();
-extern const int * get_EXIT4_PROBABILITY();
-extern const int * get_EXIT5_PROBABILITY();
-extern const int * get_EXIT6_PROBABILITY();
-extern const int * get_EXIT7_PROBABILITY();
-
-extern const int * get_EXIT1_STATE();
-extern const int * get_EXIT2_STATE();
-extern const int * get_EXIT3_STATE();
-extern const int * get_EXIT4_STATE();
-extern const int * get_EXIT5_STATE();
-extern const int * get_EXIT6_STATE();
-extern const int * get_EXIT7_STATE();
-
-extern const int * get_EXIT1_CELL_COUNT();
-extern const int * get_EXIT2_CELL_COUNT();
-extern const int * get_EXIT3_CELL_COUNT();
-extern const int * get_EXIT4_CELL_COUNT();
-extern const int * get_EXIT5_CELL_COUNT();
-extern const int * get_EXIT6_CELL_COUNT();
-extern const int * get_EXIT7_CELL_COUNT();
+extern const float * get_EMMISION_RATE_EXIT();
+extern const int * get_EXIT_PROBABILITY();
+extern const int * get_EXIT_STATE();
+extern const int * get_EXIT_CELL_COUNT();
 
 extern const float * get_TIME_SCALER();
 
@@ -144,441 +78,208 @@ void initGlobalsController()
 	collisionWeight = *get_COLLISION_WEIGHT();
 	goalWeight = *get_GOAL_WEIGHT();
 
-	emmisionRateExit1 = *get_EMMISION_RATE_EXIT1();
-	emmisionRateExit2 = *get_EMMISION_RATE_EXIT2();
-	emmisionRateExit3 = *get_EMMISION_RATE_EXIT3();
-	emmisionRateExit4 = *get_EMMISION_RATE_EXIT4();
-	emmisionRateExit5 = *get_EMMISION_RATE_EXIT5();
-	emmisionRateExit6 = *get_EMMISION_RATE_EXIT6();
-	emmisionRateExit7 = *get_EMMISION_RATE_EXIT7();
-
-	exitProbability1 = *get_EXIT1_PROBABILITY();
-	exitProbability2 = *get_EXIT2_PROBABILITY();
-	exitProbability3 = *get_EXIT3_PROBABILITY();
-	exitProbability4 = *get_EXIT4_PROBABILITY();
-	exitProbability5 = *get_EXIT5_PROBABILITY();
-	exitProbability6 = *get_EXIT6_PROBABILITY();
-	exitProbability7 = *get_EXIT7_PROBABILITY();
-
-	exitState1 = *get_EXIT1_STATE();
-	exitState2 = *get_EXIT2_STATE();
-	exitState3 = *get_EXIT3_STATE();
-	exitState4 = *get_EXIT4_STATE();
-	exitState5 = *get_EXIT5_STATE();
-	exitState6 = *get_EXIT6_STATE();
-	exitState7 = *get_EXIT7_STATE();
+	memcpy(emmisionRateExit, get_EMMISION_RATE_EXIT(), sizeof(float)*NUM_EXITS);
+	memcpy(exitProbability, get_EXIT_PROBABILITY(), sizeof(int)*NUM_EXITS);
+	memcpy(exitState, get_EXIT_STATE(), sizeof(int)*NUM_EXITS);
 }
 
 //global emmision rate
 
 void increaseGlobalEmmisionRate()
 {
-	increaseEmmisionRateExit1();
-	increaseEmmisionRateExit2();
-	increaseEmmisionRateExit3();
-	increaseEmmisionRateExit4();
-	increaseEmmisionRateExit5();
-	increaseEmmisionRateExit6();
-	increaseEmmisionRateExit7();
+	for (int i = 0; i < NUM_EXITS; i++)
+		emmisionRateExit[i] += EMISSION_RATE_INCREMENT;
+	set_EMMISION_RATE_EXIT(emmisionRateExit);
 }
 
 void decreaseGlobalEmmisionRate()
 {
-	decreaseEmmisionRateExit1();
-	decreaseEmmisionRateExit2();
-	decreaseEmmisionRateExit3();
-	decreaseEmmisionRateExit4();
-	decreaseEmmisionRateExit5();
-	decreaseEmmisionRateExit6();
-	decreaseEmmisionRateExit7();
+	for (int i = 0; i < NUM_EXITS; i++)
+		emmisionRateExit[i] -= EMISSION_RATE_INCREMENT;
+	set_EMMISION_RATE_EXIT(emmisionRateExit);
 }
 
 /* EMMISION RATES */
 
-
-//emmision rate exit 1
-void increaseEmmisionRateExit1()
+//emmision rate of a single exit (exit numbers start at 1)
+void increaseEmmisionRateExit(int exit_no)
 {
-	emmisionRateExit1 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT1(&emmisionRateExit1);
+	emmisionRateExit[exit_no-1] += EMISSION_RATE_INCREMENT;
+	set_EMMISION_RATE_EXIT(emmisionRateExit);
 }
-void decreaseEmmisionRateExit1()
+void decreaseEmmisionRateExit(int exit_no)
 {
-	emmisionRateExit1 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT1(&emmisionRateExit1);
+	emmisionRateExit[exit_no-1] -= EMISSION_RATE_INCREMENT;
+	set_EMMISION_RATE_EXIT(emmisionRateExit);
 }
-float getEmmisionRateExit1(){	return emmisionRateExit1;}
-void setEmmisionRateExit1Text(char* text)
+float getEmmisionRateExit(int exit_no){	return emmisionRateExit[exit_no-1];}
+void setEmmisionRateExitText(int exit_no, char* text)
 {	
-	float rate_pm = emmisionRateExit1 * (*get_EXIT1_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 1: %f", rate_pm);
+	float rate_pm = emmisionRateExit[exit_no-1] * get_EXIT_CELL_COUNT()[exit_no-1] * getFPS() * 60.0f * timeScaler;
+	sprintf(text, "Emmision Rate Exit %d: %f", exit_no, rate_pm);
 }
 
+//emmision rate exit 1
+void increaseEmmisionRateExit1(){	increaseEmmisionRateExit(1);}
+void decreaseEmmisionRateExit1(){	decreaseEmmisionRateExit(1);}
+float getEmmisionRateExit1(){	return getEmmisionRateExit(1);}
+void setEmmisionRateExit1Text(char* text){	setEmmisionRateExitText(1, text);}
+
 //emmision rate exit 2
-void increaseEmmisionRateExit2()
-{
-	emmisionRateExit2 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT2(&emmisionRateExit2);
-}
-void decreaseEmmisionRateExit2()
-{
-	emmisionRateExit2 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT2(&emmisionRateExit2);
-}
-float getEmmisionRateExit2(){	return emmisionRateExit2;}
-void setEmmisionRateExit2Text(char* text)
-{	
-	float rate_pm = emmisionRateExit2 * (*get_EXIT2_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 2: %f", rate_pm);
-}
+void increaseEmmisionRateExit2(){	increaseEmmisionRateExit(2);}
+void decreaseEmmisionRateExit2(){	decreaseEmmisionRateExit(2);}
+float getEmmisionRateExit2(){	return getEmmisionRateExit(2);}
+void setEmmisionRateExit2Text(char* text){	setEmmisionRateExitText(2, text);}
 
 //emmision rate exit 3
-void increaseEmmisionRateExit3()
-{
-	emmisionRateExit3 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT3(&emmisionRateExit3);
-}
-void decreaseEmmisionRateExit3()
-{
-	emmisionRateExit3 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT3(&emmisionRateExit3);
-}
-float getEmmisionRateExit3(){	return emmisionRateExit3;}
-void setEmmisionRateExit3Text(char* text)
-{	
-	float rate_pm = emmisionRateExit3 * (*get_EXIT3_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 3: %f", rate_pm);
-}
+void increaseEmmisionRateExit3(){	increaseEmmisionRateExit(3);}
+void decreaseEmmisionRateExit3(){	decreaseEmmisionRateExit(3);}
+float getEmmisionRateExit3(){	return getEmmisionRateExit(3);}
+void setEmmisionRateExit3Text(char* text){	setEmmisionRateExitText(3, text);}
 
 //emmision rate exit 4
-void increaseEmmisionRateExit4()
-{
-	emmisionRateExit4 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT4(&emmisionRateExit4);
-}
-void decreaseEmmisionRateExit4()
-{
-	emmisionRateExit4 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT4(&emmisionRateExit4);
-}
-float getEmmisionRateExit4(){	return emmisionRateExit4;}
-void setEmmisionRateExit4Text(char* text)
-{	
-	float rate_pm = emmisionRateExit4 * (*get_EXIT4_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 4: %f", rate_pm);
-}
+void increaseEmmisionRateExit4(){	increaseEmmisionRateExit(4);}
+void decreaseEmmisionRateExit4(){	decreaseEmmisionRateExit(4);}
+float getEmmisionRateExit4(){	return getEmmisionRateExit(4);}
+void setEmmisionRateExit4Text(char* text){	setEmmisionRateExitText(4, text);}
 
 //emmision rate exit 5
-void increaseEmmisionRateExit5()
-{
-	emmisionRateExit5 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT5(&emmisionRateExit5);
-}
-void decreaseEmmisionRateExit5()
-{
-	emmisionRateExit5 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT5(&emmisionRateExit5);
-}
-float getEmmisionRateExit5(){	return emmisionRateExit5;}
-void setEmmisionRateExit5Text(char* text)
-{	
-	float rate_pm = emmisionRateExit5 * (*get_EXIT5_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 5: %f", rate_pm);
-}
+void increaseEmmisionRateExit5(){	increaseEmmisionRateExit(5);}
+void decreaseEmmisionRateExit5(){	decreaseEmmisionRateExit(5);}
+float getEmmisionRateExit5(){	return getEmmisionRateExit(5);}
+void setEmmisionRateExit5Text(char* text){	setEmmisionRateExitText(5, text);}
 
 //emmision rate exit 6
-void increaseEmmisionRateExit6()
-{
-	emmisionRateExit6 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT6(&emmisionRateExit6);
-}
-void decreaseEmmisionRateExit6()
-{
-	emmisionRateExit6 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT6(&emmisionRateExit6);
-}
-float getEmmisionRateExit6(){	return emmisionRateExit6;}
-void setEmmisionRateExit6Text(char* text)
-{	
-	float rate_pm = emmisionRateExit6 * (*get_EXIT6_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 6: %f", rate_pm);
-}
+void increaseEmmisionRateExit6(){	increaseEmmisionRateExit(6);}
+void decreaseEmmisionRateExit6(){	decreaseEmmisionRateExit(6);}
+float getEmmisionRateExit6(){	return getEmmisionRateExit(6);}
+void setEmmisionRateExit6Text(char* text){	setEmmisionRateExitText(6, text);}
 
 //emmision rate exit 7
-void increaseEmmisionRateExit7()
-{
-	emmisionRateExit7 += EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT7(&emmisionRateExit7);
-}
-void decreaseEmmisionRateExit7()
-{
-	emmisionRateExit7 -= EMISSION_RATE_INCREMENT;
-	set_EMMISION_RATE_EXIT7(&emmisionRateExit7);
-}
-float getEmmisionRateExit7(){	return emmisionRateExit7;}
-void setEmmisionRateExit7Text(char* text)
-{	
-	float rate_pm = emmisionRateExit7 * (*get_EXIT7_CELL_COUNT()) * getFPS() * 60.0f * timeScaler;
-	sprintf(text, "Emmision Rate Exit 7: %f", rate_pm);
-}
+void increaseEmmisionRateExit7(){	increaseEmmisionRateExit(7);}
+void decreaseEmmisionRateExit7(){	decreaseEmmisionRateExit(7);}
+float getEmmisionRateExit7(){	return getEmmisionRateExit(7);}
+void setEmmisionRateExit7Text(char* text){	setEmmisionRateExitText(7, text);}
 
 
 
 /* PROBABILITY RATES */
 
-//exit 1 prob
-void increaseProbabilityExit1(){
-	exitProbability1 += 1;
-	set_EXIT1_PROBABILITY(&exitProbability1);
+//probability of a single exit (exit numbers start at 1)
+void increaseProbabilityExit(int exit_no){
+	exitProbability[exit_no-1] += 1;
+	set_EXIT_PROBABILITY(exitProbability);
 }
-void decreaseProbabilityExit1(){
-	exitProbability1 -= 1;
-	if (exitProbability1<1)
-		exitProbability1 = 0;
-	set_EXIT1_PROBABILITY(&exitProbability1);
+void decreaseProbabilityExit(int exit_no){
+	exitProbability[exit_no-1] -= 1;
+	if (exitProbability[exit_no-1]<1)
+		exitProbability[exit_no-1] = 0;
+	set_EXIT_PROBABILITY(exitProbability);
 }
-float getProbabilityExit1() {
-	return (float)exitProbability1/getExitProbabilityCounts();
+float getProbabilityExit(int exit_no) {
+	return (float)exitProbability[exit_no-1]/getExitProbabilityCounts();
 }
-void setProbabilityExit1Text(char* text) { 
-	sprintf(text, "Exit Probability 1: %f", getProbabilityExit1()); 
+void setProbabilityExitText(int exit_no, char* text) { 
+	sprintf(text, "Exit Probability %d: %f", exit_no, getProbabilityExit(exit_no)); 
 }
 
+//exit 1 prob
+void increaseProbabilityExit1(){	increaseProbabilityExit(1);}
+void decreaseProbabilityExit1(){	decreaseProbabilityExit(1);}
+float getProbabilityExit1() {	return getProbabilityExit(1);}
+void setProbabilityExit1Text(char* text) {	setProbabilityExitText(1, text);}
+
 //exit 2 prob
-void increaseProbabilityExit2(){
-	exitProbability2 += 1;
-	set_EXIT2_PROBABILITY(&exitProbability2);
-}
-void decreaseProbabilityExit2(){
-	exitProbability2 -= 1;
-	if (exitProbability2<1)
-		exitProbability2 = 0;
-	set_EXIT2_PROBABILITY(&exitProbability2);
-}
-float getProbabilityExit2() {
-	return (float)exitProbability2/getExitProbabilityCounts();
-}
-void setProbabilityExit2Text(char* text) { 
-	sprintf(text, "Exit Probability 2: %f", getProbabilityExit2()); 
-}
+void increaseProbabilityExit2(){	increaseProbabilityExit(2);}
+void decreaseProbabilityExit2(){	decreaseProbabilityExit(2);}
+float getProbabilityExit2() {	return getProbabilityExit(2);}
+void setProbabilityExit2Text(char* text) {	setProbabilityExitText(2, text);}
 
 //exit 3 prob
-void increaseProbabilityExit3(){
-	exitProbability3 += 1;
-	set_EXIT3_PROBABILITY(&exitProbability3);
-}
-void decreaseProbabilityExit3(){
-	exitProbability3 -= 1;
-	if (exitProbability3<1)
-		exitProbability3 = 0;
-	set_EXIT3_PROBABILITY(&exitProbability3);
-}
-float getProbabilityExit3() {
-	return (float)exitProbability3/getExitProbabilityCounts();
-}
-void setProbabilityExit3Text(char* text) { 
-	sprintf(text, "Exit Probability 3: %f", getProbabilityExit3()); 
-}
+void increaseProbabilityExit3(){	increaseProbabilityExit(3);}
+void decreaseProbabilityExit3(){	decreaseProbabilityExit(3);}
+float getProbabilityExit3() {	return getProbabilityExit(3);}
+void setProbabilityExit3Text(char* text) {	setProbabilityExitText(3, text);}
 
 //exit 4 prob
-void increaseProbabilityExit4(){
-	exitProbability4 += 1;
-	set_EXIT4_PROBABILITY(&exitProbability4);
-}
-void decreaseProbabilityExit4(){
-	exitProbability4 -= 1;
-	if (exitProbability4<1)
-		exitProbability4 = 0;
-	set_EXIT4_PROBABILITY(&exitProbability4);
-}
-float getProbabilityExit4() {
-	return (float)exitProbability4/getExitProbabilityCounts();
-}
-void setProbabilityExit4Text(char* text) { 
-	sprintf(text, "Exit Probability 4: %f", getProbabilityExit4()); 
-}
+void increaseProbabilityExit4(){	increaseProbabilityExit(4);}
+void decreaseProbabilityExit4(){	decreaseProbabilityExit(4);}
+float getProbabilityExit4() {	return getProbabilityExit(4);}
+void setProbabilityExit4Text(char* text) {	setProbabilityExitText(4, text);}
 
 //exit 5 prob
-void increaseProbabilityExit5(){
-	exitProbability5 += 1;
-	set_EXIT5_PROBABILITY(&exitProbability5);
-}
-void decreaseProbabilityExit5(){
-	exitProbability5 -= 1;
-	if (exitProbability5<1)
-		exitProbability5 = 0;
-	set_EXIT5_PROBABILITY(&exitProbability5);
-}
-float getProbabilityExit5() {
-	return (float)exitProbability5/getExitProbabilityCounts();
-}
-void setProbabilityExit5Text(char* text) { 
-	sprintf(text, "Exit Probability 5: %f", getProbabilityExit5()); 
-}
+void increaseProbabilityExit5(){	increaseProbabilityExit(5);}
+void decreaseProbabilityExit5(){	decreaseProbabilityExit(5);}
+float getProbabilityExit5() {	return getProbabilityExit(5);}
+void setProbabilityExit5Text(char* text) {	setProbabilityExitText(5, text);}
 
 //exit 6 prob
-void increaseProbabilityExit6(){
-	exitProbability6 += 1;
-	set_EXIT6_PROBABILITY(&exitProbability6);
-}
-void decreaseProbabilityExit6(){
-	exitProbability6 -= 1;
-	if (exitProbability6<1)
-		exitProbability6 = 0;
-	set_EXIT6_PROBABILITY(&exitProbability6);
-}
-float getProbabilityExit6() {
-	return (float)exitProbability6/getExitProbabilityCounts();
-}
-void setProbabilityExit6Text(char* text) { 
-	sprintf(text, "Exit Probability 6: %f", getProbabilityExit6()); 
-}
+void increaseProbabilityExit6(){	increaseProbabilityExit(6);}
+void decreaseProbabilityExit6(){	decreaseProbabilityExit(6);}
+float getProbabilityExit6() {	return getProbabilityExit(6);}
+void setProbabilityExit6Text(char* text) {	setProbabilityExitText(6, text);}
 
 //exit 7 prob
-void increaseProbabilityExit7(){
-	exitProbability7 += 1;
-	set_EXIT7_PROBABILITY(&exitProbability7);
-}
-void decreaseProbabilityExit7(){
-	exitProbability7 -= 1;
-	if (exitProbability7<1)
-		exitProbability7 = 0;
-	set_EXIT7_PROBABILITY(&exitProbability7);
-}
-float getProbabilityExit7() {
-	return (float)exitProbability7/getExitProbabilityCounts();
-}
-void setProbabilityExit7Text(char* text) { 
-	sprintf(text, "Exit Probability 7: %f", getProbabilityExit7()); 
-}
+void increaseProbabilityExit7(){	increaseProbabilityExit(7);}
+void decreaseProbabilityExit7(){	decreaseProbabilityExit(7);}
+float getProbabilityExit7() {	return getProbabilityExit(7);}
+void setProbabilityExit7Text(char* text) {	setProbabilityExitText(7, text);}
+
 
 
 /* exit states */
-//exit 1
-void toggleStateExit1()
+//state of a single exit (exit numbers start at 1)
+void toggleStateExit(int exit_no)
 {
-	exitState1 = !exitState1;
-	set_EXIT1_STATE(&exitState1);
+	exitState[exit_no-1] = !exitState[exit_no-1];
+	set_EXIT_STATE(exitState);
 }
-int getStateExit1()
+int getStateExit(int exit_no)
 {
-	return exitState1;
+	return exitState[exit_no-1];
 }
-void setStateExit1Text(char* text)
+void setStateExitText(int exit_no, char* text)
 {
-	if (exitState1)
-		sprintf(text, "Exit 1 State: OPEN");
+	if (exitState[exit_no-1])
+		sprintf(text, "Exit %d State: OPEN", exit_no);
 	else
-		sprintf(text, "Exit 1 State: CLOSED");
+		sprintf(text, "Exit %d State: CLOSED", exit_no);
 }
 
+//exit 1
+void toggleStateExit1(){	toggleStateExit(1);}
+int getStateExit1(){	return getStateExit(1);}
+void setStateExit1Text(char* text){	setStateExitText(1, text);}
+
 //exit 2
-void toggleStateExit2()
-{
-	exitState2 = !exitState2;
-	set_EXIT2_STATE(&exitState2);
-}
-int getStateExit2()
-{
-	return exitState2;
-}
-void setStateExit2Text(char* text)
-{
-	if (exitState2)
-		sprintf(text, "Exit 2 State: OPEN");
-	else
-		sprintf(text, "Exit 2 State: CLOSED");
-}
+void toggleStateExit2(){	toggleStateExit(2);}
+int getStateExit2(){	return getStateExit(2);}
+void setStateExit2Text(char* text){	setStateExitText(2, text);}
 
 //exit 3
-void toggleStateExit3()
-{
-	exitState3 = !exitState3;
-	set_EXIT3_STATE(&exitState3);
-}
-int getStateExit3()
-{
-	return exitState3;
-}
-void setStateExit3Text(char* text)
-{
-	if (exitState3)
-		sprintf(text, "Exit 3 State: OPEN");
-	else
-		sprintf(text, "Exit 3 State: CLOSED");
-}
+void toggleStateExit3(){	toggleStateExit(3);}
+int getStateExit3(){	return getStateExit(3);}
+void setStateExit3Text(char* text){	setStateExitText(3, text);}
 
 //exit 4
-void toggleStateExit4()
-{
-	exitState4 = !exitState4;
-	set_EXIT4_STATE(&exitState4);
-}
-int getStateExit4()
-{
-	return exitState4;
-}
-void setStateExit4Text(char* text)
-{
-	if (exitState4)
-		sprintf(text, "Exit 4 State: OPEN");
-	else
-		sprintf(text, "Exit 4 State: CLOSED");
-}
+void toggleStateExit4(){	toggleStateExit(4);}
+int getStateExit4(){	return getStateExit(4);}
+void setStateExit4Text(char* text){	setStateExitText(4, text);}
 
 //exit 5
-void toggleStateExit5()
-{
-	exitState5 = !exitState5;
-	set_EXIT5_STATE(&exitState5);
-}
-int getStateExit5()
-{
-	return exitState5;
-}
-void setStateExit5Text(char* text)
-{
-	if (exitState5)
-		sprintf(text, "Exit 5 State: OPEN");
-	else
-		sprintf(text, "Exit 5 State: CLOSED");
-}
+void toggleStateExit5(){	toggleStateExit(5);}
+int getStateExit5(){	return getStateExit(5);}
+void setStateExit5Text(char* text){	setStateExitText(5, text);}
 
 //exit 6
-void toggleStateExit6()
-{
-	exitState6 = !exitState6;
-	set_EXIT6_STATE(&exitState6);
-}
-int getStateExit6()
-{
-	return exitState6;
-}
-void setStateExit6Text(char* text)
-{
-	if (exitState6)
-		sprintf(text, "Exit 6 State: OPEN");
-	else
-		sprintf(text, "Exit 6 State: CLOSED");
-}
+void toggleStateExit6(){	toggleStateExit(6);}
+int getStateExit6(){	return getStateExit(6);}
+void setStateExit6Text(char* text){	setStateExitText(6, text);}
 
 //exit 7
-void toggleStateExit7()
-{
-	exitState7 = !exitState7;
-	set_EXIT7_STATE(&exitState7);
-}
-int getStateExit7()
-{
-	return exitState7;
-}
-void setStateExit7Text(char* text)
-{
-	if (exitState7)
-		sprintf(text, "Exit 7 State: OPEN");
-	else
-		sprintf(text, "Exit 7 State: CLOSED");
-}
+void toggleStateExit7(){	toggleStateExit(7);}
+int getStateExit7(){	return getStateExit(7);}
+void setStateExit7Text(char* text){	setStateExitText(7, text);}
 
 //time scaler
 void increaseTimeScaler()
@@ -679,5 +380,8 @@ void setGoalWeightText(char* text){
 //privates
 float getExitProbabilityCounts()
 {
-	return (float)exitProbability1 + exitProbability2 + exitProbability3 + exitProbability4 + exitProbability5 + exitProbability6 + exitProbability7; 
+	float count = 0;
+	for (int i = 0; i < NUM_EXITS; i++)
+		count += exitProbability[i];
+	return count; 
 }
@@ -16,6 +16,9 @@
 #ifndef __GLOBALS_CONTROLLER
 #define __GLOBALS_CONTROLLER
 
+// Number of exits in the domain, must match the arrayLength of the EXIT environment constant arrays in XMLModelFile.xml
+#define NUM_EXITS 10
+
 #define EMISSION_RATE_INCREMENT 0.01f
 #define TIME_SCALER_INCREMENT	0.00001
 #define STEER_WEIGHT_INCREMENT		0.001
@@ -29,6 +32,10 @@ void increaseGlobalEmmisionRate();
 void decreaseGlobalEmmisionRate();
 
 //emmision rates
+void increaseEmmisionRateExit(int exit_no);
+void decreaseEmmisionRateExit(int exit_no);
+float getEmmisionRateExit(int exit_no);
+void setEmmisionRateExitText(int exit_no, char* text);
 void increaseEmmisionRateExit1();
 void decreaseEmmisionRateExit1();
 float getEmmisionRateExit1();
@@ -59,6 +66,10 @@ float getEmmisionRateExit7();
 void setEmmisionRateExit7Text(char* text);
 
 //exit probabilities
+void increaseProbabilityExit(int exit_no);
+void decreaseProbabilityExit(int exit_no);
+float getProbabilityExit(int exit_no);
+void setProbabilityExitText(int exit_no, char* text);
 void increaseProbabilityExit1();
 void decreaseProbabilityExit1();
 float getProbabilityExit1();
@@ -89,6 +100,9 @@ float getProbabilityExit7();
 void setProbabilityExit7Text(char* text);
 
 //exit states
+void toggleStateExit(int exit_no);
+int getStateExit(int exit_no);
+void setStateExitText(int exit_no, char* text);
 void toggleStateExit1();
 int getStateExit1();
 void setStateExit1Text(char* text);
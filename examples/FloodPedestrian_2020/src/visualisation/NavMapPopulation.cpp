@@ -32,8 +32,9 @@ int drawArrows  = 1;
 /** Macro for toggling the use of a single large vbo */
 BOOLEAN useLargeVBO = TRUE;
 
-//navigation map width
+//navigation map width and height
 int nm_width;
+int nm_height;
 
 //navmap instances
 GLuint nm_instances_tbo;
@@ -60,12 +61,15 @@ GLuint nm_shaderProgram;
 GLuint nmvs_instance_map;
 GLuint nmvs_instance_index;
 GLuint nmvs_NM_WIDTH;
+GLuint nmvs_NM_HEIGHT;
 GLuint nmvs_ENV_MAX;
 GLuint nmvs_ENV_WIDTH;
 
 //external prototypes imported from FLAME GPU
 extern int get_agent_navmap_MAX_count();
 extern int get_agent_navmap_static_count();
+extern int get_navmap_population_width();
+extern int get_navmap_population_height();
 
 //PRIVATE PROTOTYPES
 /** createNavMapBufferObjects
@@ -82,7 +86,8 @@ void initNavMapPopulation()
 {
 	float scale;
 
-	nm_width = (int)floor(sqrt((float)get_agent_navmap_MAX_count()));
+	nm_width = get_navmap_population_width();
+	nm_height = get_navmap_population_height();
 
 	arrow_v_count = 25;
 	arrow_f_count = 46;
@@ -90,7 +95,7 @@ void initNavMapPopulation()
 	//load cone model
 	allocateObjModel(arrow_v_count, arrow_f_count, &arrow_vertices, &arrow_normals, &arrow_faces);
 	loadObjFromFile("../../media/cone.obj",	arrow_v_count, arrow_f_count, arrow_vertices, arrow_normals, arrow_faces);
-	scale = ENV_MAX/(float)nm_width;
+	scale = ENV_MAX/(float)((nm_width > nm_height) ? nm_width : nm_height);
 	scaleObj(scale, arrow_v_count, arrow_vertices);		 
 	
 
@@ -173,12 +178,12 @@ void renderNavMapPopulation()
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		glBegin(GL_QUADS);
 		{
-			for (y=0; y<nm_width; y++){
+			for (y=0; y<nm_height; y++){
 				for (x=0; x<nm_width; x++){
 					float x_min = (float)(x)/((float)nm_width/(float)ENV_WIDTH)-ENV_MAX;
 					float x_max = (float)(x+1)/((float)nm_width/(float)ENV_WIDTH)-ENV_MAX;
-					float y_min = (float)(y)/((float)nm_width/(float)ENV_WIDTH)-ENV_MAX;
-					float y_max = (float)(y+1)/((float)nm_width/(float)ENV_WIDTH)-ENV_MAX;
+					float y_min = (float)(y)/((float)nm_height/(float)ENV_WIDTH)-ENV_MAX;
+					float y_max = (float)(y+1)/((float)nm_height/(float)ENV_WIDTH)-ENV_MAX;
 
 					glVertex2f(x_min, y_min);
 					glVertex2f(x_min, y_max);
@@ -312,12 +317,14 @@ void initNavMapShader()
 	nmvs_instance_map = glGetUniformLocation(nm_shaderProgram, "instance_map");
 	nmvs_instance_index = glGetAttribLocation(nm_shaderProgram, "instance_index"); 
 	nmvs_NM_WIDTH = glGetUniformLocation(nm_shaderProgram, "NM_WIDTH");
+	nmvs_NM_HEIGHT = glGetUniformLocation(nm_shaderProgram, "NM_HEIGHT");
 	nmvs_ENV_MAX = glGetUniformLocation(nm_shaderProgram, "ENV_MAX");
 	nmvs_ENV_WIDTH = glGetUniformLocation(nm_shaderProgram, "ENV_WIDTH");
 
 	//set uniforms (need to use prgram to do so)
 	glUseProgram(nm_shaderProgram);
 	glUniform1f(nmvs_NM_WIDTH, (float)nm_width);
+	glUniform1f(nmvs_NM_HEIGHT, (float)nm_height);
 	glUniform1f(nmvs_ENV_MAX, ENV_MAX);
 	glUniform1f(nmvs_ENV_WIDTH, ENV_WIDTH);
 	glUseProgram(0);
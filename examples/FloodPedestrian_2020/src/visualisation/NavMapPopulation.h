@@ -78,6 +78,7 @@ static const char navmap_vshader_source[] =
 	"#extension EXT_gpu_shader4 : require   										\n"
 	"uniform samplerBuffer instance_map;											\n"
 	"uniform float NM_WIDTH;														\n"
+	"uniform float NM_HEIGHT;														\n"
 	"uniform float ENV_MAX;															\n"
 	"uniform float ENV_WIDTH;														\n"
 	"attribute in float instance_index;												\n"
@@ -118,7 +119,7 @@ static const char navmap_vshader_source[] =
 
 	"   //offset model position														\n"
 	"	float x_displace = ((instance.x+0.5)/(NM_WIDTH/ENV_WIDTH))-ENV_MAX;			\n"
-	"	float y_displace = ((instance.y+0.5)/(NM_WIDTH/ENV_WIDTH))-ENV_MAX;			\n"
+	"	float y_displace = ((instance.y+0.5)/(NM_HEIGHT/ENV_WIDTH))-ENV_MAX;			\n"
 	"   position.x += x_displace;													\n"
 	"   position.y += y_displace;													\n"
 	"   position.z += instance.w*0.0775;													\n"
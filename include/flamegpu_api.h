@@ -0,0 +1,245 @@
+/*
+ * FLAME GPU v 1.5.X for CUDA 9
+ * Copyright University of Sheffield.
+ * Original Author: Dr Paul Richmond (user contributions tracked on https://github.com/FLAMEGPU/FLAMEGPU)
+ * Contact: p.richmond@sheffield.ac.uk (http://www.paulrichmond.staff.shef.ac.uk)
+ *
+ * University of Sheffield retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.
+ * Any use, reproduction, disclosure, or distribution of this software
+ * and related documentation without an express license agreement from
+ * University of Sheffield is strictly prohibited.
+ *
+ * For terms of licence agreement please attached licence or view licence
+ * on www.flamegpu.com website.
+ *
+ */
+
+/*
+ * C API of a FLAME GPU model, to embed the simulation in another program (see the 'library' make target, which builds
+ * lib<EXAMPLE>.a and lib<EXAMPLE>.so from the dynamic files of the model). The console executable is a client of the same API.
+ *
+ * Agents, states, variables and environment constants are named as in the model file, so the API is the same for every model.
+ * The simulation state is held in globals of the generated code, so a process has at most one simulation at a time. Invalid
+ * arguments, invalid checkpoints and checkpoint files that cannot be read or written return an error code; errors of the
+ * simulation itself (CUDA errors or invalid initial states files) print a message and exit the process, as in the executables.
+ */
+
+#ifndef _FLAMEGPU_API_H_
+#define _FLAMEGPU_API_H_
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(FLAMEGPU_SHARED)
+#ifdef FLAMEGPU_API_BUILD
+#define FLAMEGPU_API __declspec(dllexport)
+#else
+#define FLAMEGPU_API __declspec(dllimport)
+#endif
+#else
+#define FLAMEGPU_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLAMEGPU_API_VERSION 1				/**< version of this API, increased whenever a function changes */
+
+/* Status codes, the functions returning int return a negative status code on failure */
+#define FLAMEGPU_SUCCESS 0
+#define FLAMEGPU_ERROR_INVALID_ARGUMENT -1	/**< a null pointer or out of range value */
+#define FLAMEGPU_ERROR_UNKNOWN_NAME -2		/**< the agent, state, variable or environment constant is not in the model */
+#define FLAMEGPU_ERROR_BUFFER_TOO_SMALL -3	/**< the destination buffer is smaller than the data */
+#define FLAMEGPU_ERROR_INVALID_CHECKPOINT -4	/**< the checkpoint is not of this model or layout version, the simulation is unchanged */
+#define FLAMEGPU_ERROR_IO -5				/**< a file could not be opened, read or written */
+
+/** flamegpu_simulation
+ * Handle of a simulation created by flamegpu_create
+ */
+typedef struct flamegpu_simulation flamegpu_simulation;
+
+/** flamegpu_config
+ * Settings of flamegpu_create, initialise with flamegpu_default_config
+ */
+typedef struct flamegpu_config {
+	const char* input_path;		/**< initial states XML file, NULL or "" to start without agents (e.g. before flamegpu_load_state) */
+	const char* output_dir;		/**< directory of the outputs, NULL for the directory of input_path (or the working directory) */
+	int device;					/**< CUDA device id */
+	int host_functions;			/**< if nonzero the init functions are called by flamegpu_create and the exit functions by flamegpu_destroy */
+} flamegpu_config;
+
+/** flamegpu_default_config
+ * Sets the default settings: no initial states, outputs in the working directory, device 0, init and exit functions called
+ * @param config settings to initialise
+ */
+FLAMEGPU_API void flamegpu_default_config(flamegpu_config* config);
+
+/** flamegpu_create
+ * Selects the CUDA device, allocates the simulation and reads the initial states
+ * @param config settings of the simulation
+ * @return the simulation, NULL if config is NULL or a simulation exists
+ */
+FLAMEGPU_API flamegpu_simulation* flamegpu_create(const flamegpu_config* config);
+
+/** flamegpu_destroy
+ * Calls the exit functions (if host_functions was set), frees the simulation and resets the CUDA device
+ * @param simulation simulation to destroy
+ */
+FLAMEGPU_API void flamegpu_destroy(flamegpu_simulation* simulation);
+
+/** flamegpu_step
+ * Runs iterations of the simulation. It stops early after an iteration in which an exit condition of the model returned EXIT.
+ * @param simulation simulation
+ * @param iterations maximum number of iterations
+ * @return number of iterations run, or a status code
+ */
+FLAMEGPU_API int flamegpu_step(flamegpu_simulation* simulation, int iterations);
+
+/** flamegpu_exit_condition_met
+ * @param simulation simulation
+ * @return nonzero if an exit condition of the model returned EXIT after the last iteration run by flamegpu_step
+ */
+FLAMEGPU_API int flamegpu_exit_condition_met(flamegpu_simulation* simulation);
+
+/** flamegpu_get_iteration
+ * @param simulation simulation
+ * @return number of iterations run since the initial states (or of the loaded state)
+ */
+FLAMEGPU_API unsigned int flamegpu_get_iteration(flamegpu_simulation* simulation);
+
+/** flamegpu_save_state
+ * Copies the complete simulation state (a checkpoint image, as written by --save-checkpoint) into a buffer. The size of the image
+ * only depends on the model, so it can be queried once with a NULL buffer.
+ * @param simulation simulation
+ * @param buffer destination of the image, may be NULL if capacity is 0
+ * @param capacity size of buffer in bytes
+ * @param size set to the size of the image in bytes
+ * @return FLAMEGPU_SUCCESS, or FLAMEGPU_ERROR_BUFFER_TOO_SMALL if capacity is smaller than the image (size is set)
+ */
+FLAMEGPU_API int flamegpu_save_state(flamegpu_simulation* simulation, void* buffer, size_t capacity, size_t* size);
+
+/** flamegpu_load_state
+ * Replaces the complete simulation state with a checkpoint image of the same model (from flamegpu_save_state or a checkpoint file)
+ * @param simulation simulation
+ * @param buffer checkpoint image
+ * @param size size of the image in bytes
+ * @return FLAMEGPU_SUCCESS, or FLAMEGPU_ERROR_INVALID_CHECKPOINT if the image is not of this model (the simulation is unchanged)
+ */
+FLAMEGPU_API int flamegpu_load_state(flamegpu_simulation* simulation, const void* buffer, size_t size);
+
+/** flamegpu_save_state_file
+ * Writes the complete simulation state to a checkpoint file
+ * @param simulation simulation
+ * @param path file path of the checkpoint
+ * @return FLAMEGPU_SUCCESS, or FLAMEGPU_ERROR_IO if the file could not be written
+ */
+FLAMEGPU_API int flamegpu_save_state_file(flamegpu_simulation* simulation, const char* path);
+
+/** flamegpu_load_state_file
+ * Replaces the complete simulation state with that of a checkpoint file of the same model
+ * @param simulation simulation
+ * @param path file path of the checkpoint
+ * @return FLAMEGPU_SUCCESS, FLAMEGPU_ERROR_IO if the file could not be read or FLAMEGPU_ERROR_INVALID_CHECKPOINT (the simulation
+ * is unchanged)
+ */
+FLAMEGPU_API int flamegpu_load_state_file(flamegpu_simulation* simulation, const char* path);
+
+/** flamegpu_set_env
+ * Sets an environment constant, the value is parsed as in the environment of an initial states file (e.g. "1.5" or "1,2,3")
+ * @param simulation simulation
+ * @param name name of the environment constant
+ * @param value value of the constant as text
+ * @return FLAMEGPU_SUCCESS, FLAMEGPU_ERROR_UNKNOWN_NAME, or FLAMEGPU_ERROR_INVALID_ARGUMENT if the value is not a number of the
+ * type of the constant or has the wrong number of items (the constant is unchanged)
+ */
+FLAMEGPU_API int flamegpu_set_env(flamegpu_simulation* simulation, const char* name, const char* value);
+
+/** flamegpu_seed
+ * Seeds the random number generator of the agent functions
+ * @param simulation simulation
+ * @param seed seed
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_seed(flamegpu_simulation* simulation, unsigned int seed);
+
+/** flamegpu_run_init_functions
+ * Calls the init functions of the model (e.g. after loading a state or changing constants, if host_functions was not set)
+ * @param simulation simulation
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_run_init_functions(flamegpu_simulation* simulation);
+
+/** flamegpu_run_exit_functions
+ * Calls the exit functions of the model
+ * @param simulation simulation
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_run_exit_functions(flamegpu_simulation* simulation);
+
+/** flamegpu_get_agent_count
+ * @param simulation simulation
+ * @param agent name of the agent
+ * @param state name of the state
+ * @return number of agents in the state, or a status code
+ */
+FLAMEGPU_API int flamegpu_get_agent_count(flamegpu_simulation* simulation, const char* agent, const char* state);
+
+/** flamegpu_get_variable_size
+ * @param simulation simulation
+ * @param agent name of the agent
+ * @param variable name of the agent variable
+ * @return bytes of the variable per agent (the size of its type times its array length), 0 if unknown
+ */
+FLAMEGPU_API size_t flamegpu_get_variable_size(flamegpu_simulation* simulation, const char* agent, const char* variable);
+
+/** flamegpu_get_column
+ * Copies a variable of all agents in a state from the device, in the order of the agents. Array variables are copied element
+ * by element: the first element of all agents, then the second element of all agents and so on.
+ * @param simulation simulation
+ * @param agent name of the agent
+ * @param state name of the state
+ * @param variable name of the agent variable
+ * @param dst destination, of the type of the variable
+ * @param capacity size of dst in bytes
+ * @return number of agents copied, or a status code
+ */
+FLAMEGPU_API int flamegpu_get_column(flamegpu_simulation* simulation, const char* agent, const char* state, const char* variable, void* dst, size_t capacity);
+
+/** flamegpu_set_output_dir
+ * Sets the directory of the outputs of the simulation (XML outputs, logs and the files of host functions)
+ * @param simulation simulation
+ * @param directory existing directory, "" for the working directory
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_set_output_dir(flamegpu_simulation* simulation, const char* directory);
+
+/** flamegpu_get_output_dir
+ * @param simulation simulation
+ * @return the output directory, ending with a path separator unless it is the working directory ("")
+ */
+FLAMEGPU_API const char* flamegpu_get_output_dir(flamegpu_simulation* simulation);
+
+/** flamegpu_enable_metrics
+ * Writes the metrics of the simulation and the model (see createMetric in header.h) in the Prometheus text format to a file, replaced
+ * atomically at most every interval seconds and after the exit functions
+ * @param simulation simulation
+ * @param path file path of the metrics
+ * @param interval wall clock seconds between writes
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_enable_metrics(flamegpu_simulation* simulation, const char* path, double interval);
+
+/** flamegpu_write_output
+ * Writes all agents to <output dir><number>.xml, as the XML output of the console executable
+ * @param simulation simulation
+ * @param number number of the output file, e.g. the iteration
+ * @return status code
+ */
+FLAMEGPU_API int flamegpu_write_output(flamegpu_simulation* simulation, int number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //_FLAMEGPU_API_H_
@@ -33,6 +33,9 @@ DEFAULT_SMS_CUDA_6 := 30 35 37 50
 OBJ_EXT := .o
 # Set the default binary extension - no extension.
 BIN_EXT :=
+# Static and shared library extensions.
+LIB_EXT := .a
+SHARED_EXT := .so
 
 # OS Specific directoryes and file extensions.
 ifeq ($(OS),Windows_NT)
@@ -41,6 +44,8 @@ ifeq ($(OS),Windows_NT)
 	# Override default values for windows.
 	BIN_EXT := .exe
 	OBJ_EXT := .obj
+	LIB_EXT := .lib
+	SHARED_EXT := .dll
 else
 	UNAME_S := $(shell uname -s)
 	ifeq ($(UNAME_S),Linux)
@@ -159,6 +164,11 @@ ifeq ($(profile),1)
 else
 endif
 
+# Enable / Disable the trace of layer and function timings (trace.json and trace_summary.csv)
+ifeq ($(trace),1)
+	NVCCFLAGS += -DINSTRUMENT_TRACE=1
+endif
+
 # Compute the actual build directory, by appending the mode type.
 BUILD_DIR := $(BUILD_DIR)/$(Mode_TYPE)
 
@@ -212,9 +222,17 @@ VISUALISATION_INCLUDES := $(addprefix -I ,$(INCLUDE_DIRS_VISUALISATION))
 # Generate the full path to target executable files
 TARGET_VISUALISATION := $(BIN_DIR)/$(Mode_TYPE)_Visualisation/$(EXAMPLE)$(BIN_EXT)
 TARGET_CONSOLE := $(BIN_DIR)/$(Mode_TYPE)_Console/$(EXAMPLE)$(BIN_EXT)
+TARGET_LIBRARY_STATIC := $(BIN_DIR)/$(Mode_TYPE)_Library/lib$(EXAMPLE)$(LIB_EXT)
+TARGET_LIBRARY_SHARED := $(BIN_DIR)/$(Mode_TYPE)_Library/lib$(EXAMPLE)$(SHARED_EXT)
 
 # Dependancies for the targets
 CONSOLE_DEPENDANCIES := $(BUILD_DIR)/io.cu$(OBJ_EXT) $(BUILD_DIR)/simulation.cu$(OBJ_EXT) $(BUILD_DIR)/main_console.cu$(OBJ_EXT)
+# The library is the console build without main, compiled as position independent code (see include/flamegpu_api.h)
+LIBRARY_DEPENDANCIES := $(BUILD_DIR)/library/io.cu$(OBJ_EXT) $(BUILD_DIR)/library/simulation.cu$(OBJ_EXT)
+LIBRARY_CCFLAGS := -DFLAMEGPU_SHARED -DFLAMEGPU_API_BUILD
+ifneq ($(OS),Windows_NT)
+LIBRARY_CCFLAGS += -Xcompiler -fPIC
+endif
 
 DISABLED_XSLT_TRANSFORMS :=
 
@@ -301,7 +319,7 @@ endif
 ################################################################################
 
 # Mark several targets as PHONY, i.e. they do not create a file of the target name
-.PHONY: help all validate xslt visualisation console clean clobber makedirs functions.c
+.PHONY: help all validate xslt visualisation console library clean clobber makedirs functions.c
 
 # When make all is called, the model is validated, all xslt is generated and then both console and visualisation targets are built
 ifeq ($(HAS_VISUALISATION), 1)
@@ -329,6 +347,9 @@ functions.c: validate $(XSLT_FUNCTIONS_C) $(MAKEFILE_LIST)
 # Create the console version of this application, inlcuding directory creation and validation of the XML Model
 console: makedirs validate $(TARGET_CONSOLE)
 
+# Create the static and shared libraries of the model (the C API of include/flamegpu_api.h), inlcuding directory creation and validation of the XML Model
+library: makedirs validate $(TARGET_LIBRARY_STATIC) $(TARGET_LIBRARY_SHARED)
+
 # Create the visualisation version of this application, inlcuding directory creation and validation of the XML Model
 ifeq ($(HAS_VISUALISATION), 1)
 visualisation: makedirs validate $(TARGET_VISUALISATION)
@@ -412,6 +433,12 @@ $(BUILD_DIR)/simulation.cu$(OBJ_EXT): $(SRC_DYNAMIC)/simulation.cu $(SRC_DYNAMIC
 $(BUILD_DIR)/main_console.cu$(OBJ_EXT): $(SRC_DYNAMIC)/main.cu $(SRC_DYNAMIC)/header.h $(MAKEFILE_LIST)
 	$(EXEC) $(NVCC) $(CONSOLE_INCLUDES) $(ALL_CCFLAGS) $(GENCODE_FLAGS) -o $@ -c $<
 
+# Library specific dynamic file rules.
+$(BUILD_DIR)/library/io.cu$(OBJ_EXT): $(SRC_DYNAMIC)/io.cu $(SRC_DYNAMIC)/header.h $(MAKEFILE_LIST)
+	$(EXEC) $(NVCC) $(CONSOLE_INCLUDES) $(ALL_CCFLAGS) $(LIBRARY_CCFLAGS) $(GENCODE_FLAGS) -o $@ -c $<
+$(BUILD_DIR)/library/simulation.cu$(OBJ_EXT): $(SRC_DYNAMIC)/simulation.cu $(SRC_DYNAMIC)/FLAMEGPU_kernals.cu $(FUNCTIONS_FILES) $(SRC_DYNAMIC)/header.h $(MAKEFILE_LIST)
+	$(EXEC) $(NVCC) $(CONSOLE_INCLUDES) $(ALL_CCFLAGS) $(LIBRARY_CCFLAGS) $(GENCODE_FLAGS) -o $@ -c $<
+
 ifeq ($(HAS_VISUALISATION), 1)
 # Visualisation specific dynamic file rules.
 $(BUILD_DIR)/main_visualisation.cu$(OBJ_EXT): $(SRC_DYNAMIC)/main.cu $(SRC_DYNAMIC)/header.h $(MAKEFILE_LIST)
@@ -441,6 +468,12 @@ endif
 $(TARGET_CONSOLE): $(CONSOLE_DEPENDANCIES)
 	$(EXEC) $(NVCC) $(ALL_LDFLAGS) $(GENCODE_FLAGS) -o $@ $+
 
+# Rules to create the static and shared libraries from the library object files.
+$(TARGET_LIBRARY_STATIC): $(LIBRARY_DEPENDANCIES)
+	$(EXEC) $(NVCC) -lib $(ALL_CCFLAGS) $(GENCODE_FLAGS) -o $@ $+
+$(TARGET_LIBRARY_SHARED): $(LIBRARY_DEPENDANCIES)
+	$(EXEC) $(NVCC) --shared $(ALL_LDFLAGS) $(GENCODE_FLAGS) -o $@ $+
+
 # Clean object files, but do not regenerate xslt. `|| true` is used to support the case where dirs do not exist.
 clean:
 	@find $(EXAMPLE_BUILD_DIR)/ -name '*$(OBJ_EXT)' -delete 2> /dev/null || true
@@ -453,12 +486,16 @@ clobber: clean
 	@find $(SRC_DYNAMIC)/ -name '*.cu' -delete 2> /dev/null || true
 	@find $(SRC_DYNAMIC)/ -name '*.h' -delete 2> /dev/null || true
 	@find $(BIN_DIR)/ -name '$(EXAMPLE)$(BIN_EXT)' -delete 2> /dev/null || true
+	@find $(BIN_DIR)/ -name 'lib$(EXAMPLE)$(LIB_EXT)' -delete 2> /dev/null || true
+	@find $(BIN_DIR)/ -name 'lib$(EXAMPLE)$(SHARED_EXT)' -delete 2> /dev/null || true
 
 # Create any required directories.
 makedirs:
 	@mkdir -p $(BIN_DIR)/$(Mode_TYPE)_Console
 	@mkdir -p $(BIN_DIR)/$(Mode_TYPE)_Visualisation
+	@mkdir -p $(BIN_DIR)/$(Mode_TYPE)_Library
 	@mkdir -p $(BUILD_DIR)
+	@mkdir -p $(BUILD_DIR)/library
 	@mkdir -p $(SRC_DYNAMIC)
 
 # Help target, printing usage information to stdout
@@ -480,6 +517,8 @@ help:
 	@echo "                    depends on 'xsltproc'"
 	@echo "   console       Builds console mode exectuable"
 	@echo "   visualistion  Builds visualisation mode executable, if it exists"
+	@echo "   library       Builds lib$(EXAMPLE)$(LIB_EXT) and lib$(EXAMPLE)$(SHARED_EXT), the model"
+	@echo "                   behind the C API of include/flamegpu_api.h"
 	@echo "   clean         Deletes generated object files"
 	@echo "   clobber       Deletes all generated files including executables"
 	@echo "   functions.c   Generates functions.c.tmp in the dynamic folder using xslt"
@@ -497,6 +536,11 @@ help:
 	@echo "                   0 : Off (Default)"
 	@echo "                   1 : On"
 	@echo "                   I.e. 'make console profile=1'"
+	@echo "   trace=<arg>   Records layer, function and output timings to trace.json"
+	@echo "                   (Chrome / Perfetto trace) and trace_summary.csv"
+	@echo "                   0 : Off (Default)"
+	@echo "                   1 : On"
+	@echo "                   I.e. 'make console trace=1'"
 	@echo "   SMS=<arg>     Builds target for the specified CUDA architectures"
 	@echo "                   I.e. 'make console SMS=\"60 61\"'"
 	@echo "                   Defaults to: '$(SMS)'"